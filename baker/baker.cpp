@@ -0,0 +1,232 @@
+// offline asset baker: decodes and converts everything the app loads at startup into one pack file
+// (see src/pack.hpp), so the app only has to map it and copy payloads into staging memory.
+// built with "make assetbaker", "make pack" bakes assets.pack from the source assets and compiled shaders.
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_PNG
+#include "stb_image.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "vloader.hpp"
+#include "mapped_file.hpp"
+#include "pack.hpp"
+
+namespace {
+    struct image {
+        uint32_t width, height;
+        std::vector<uint8_t> rgba;
+    };
+
+    image decode(const std::string& path, bool flip) {
+        stbi_set_flip_vertically_on_load(flip);
+
+        io::mappedFile file(path);
+
+        int w, h, chans;
+        unsigned char* data = stbi_load_from_memory(file.data(), file.size(), &w, &h, &chans, STBI_rgb_alpha);
+        if (!data) {
+            throw std::runtime_error("cannot load texture " + path + "!");
+        }
+
+        image img{uint32_t(w), uint32_t(h), std::vector<uint8_t>(data, data + size_t(w) * h * 4)};
+        stbi_image_free(data);
+        return img;
+    }
+
+    float toLinear(uint8_t c) {
+        const float s = c / 255.0f;
+        return s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+    }
+
+    uint8_t toSrgb(float l) {
+        const float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+        return uint8_t(std::clamp(s, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    // 2x2 box filter in linear space, like the blits the app does for srgb images at runtime
+    image downsample(const image& src) {
+        image dst{std::max(src.width / 2, 1u), std::max(src.height / 2, 1u), {}};
+        dst.rgba.resize(size_t(dst.width) * dst.height * 4);
+
+        for (uint32_t y = 0; y < dst.height; y++) {
+            for (uint32_t x = 0; x < dst.width; x++) {
+                const uint32_t x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+                const uint32_t y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+                const uint8_t* p[4] = {
+                    &src.rgba[(size_t(y0) * src.width + x0) * 4], &src.rgba[(size_t(y0) * src.width + x1) * 4],
+                    &src.rgba[(size_t(y1) * src.width + x0) * 4], &src.rgba[(size_t(y1) * src.width + x1) * 4],
+                };
+
+                uint8_t* out = &dst.rgba[(size_t(y) * dst.width + x) * 4];
+                for (int c = 0; c < 3; c++) {
+                    out[c] = toSrgb((toLinear(p[0][c]) + toLinear(p[1][c]) + toLinear(p[2][c]) + toLinear(p[3][c])) / 4.0f);
+                }
+                out[3] = uint8_t((p[0][3] + p[1][3] + p[2][3] + p[3][3] + 2) / 4); // alpha is linear already
+            }
+        }
+        return dst;
+    }
+
+    class writer {
+    public:
+        explicit writer(const std::string& path) : out(path, std::ios::binary | std::ios::trunc) {
+            if (!out) {
+                throw std::runtime_error("cannot open " + path + " for writing!");
+            }
+            pack::header h{};
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h)); // filled in by finish()
+        }
+
+        // starts a payload, returns its entry so the caller can fill in the info fields
+        pack::entry& begin(const std::string& name, pack::kind type) {
+            if (name.size() >= sizeof(pack::entry::name)) {
+                throw std::runtime_error("asset name too long: " + name);
+            }
+
+            pad(pack::payloadAlign);
+
+            pack::entry e{};
+            strncpy(e.name, name.c_str(), sizeof(e.name) - 1);
+            e.type = type;
+            e.offset = out.tellp();
+            toc.push_back(e);
+            return toc.back();
+        }
+
+        void write(const void* data, size_t size) {
+            out.write(static_cast<const char*>(data), size);
+            toc.back().size += size;
+        }
+
+        void finish(uint32_t vertexSize) {
+            pad(alignof(pack::entry));
+
+            pack::header h{};
+            h.magic = pack::magic;
+            h.version = pack::version;
+            h.vertexSize = vertexSize;
+            h.entryCount = toc.size();
+            h.tocOffset = out.tellp();
+
+            out.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(pack::entry));
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+            if (!out) {
+                throw std::runtime_error("cannot write pack file!");
+            }
+        }
+
+    private:
+        std::ofstream out;
+        std::vector<pack::entry> toc;
+
+        void pad(uint64_t align) {
+            static const char zeros[pack::payloadAlign] = {};
+            const uint64_t pos = out.tellp();
+            out.write(zeros, (align - pos % align) % align);
+        }
+    };
+
+    void bakeMesh(writer& w, const std::string& path) {
+        vload::vloader l(path, false, false);
+        const auto& m = l.meshList[0]; // the app only ever draws the first mesh
+
+        pack::entry& e = w.begin(path, pack::kind::mesh);
+        e.info[0] = m.verts.size();
+        e.info[1] = m.indices.size();
+        w.write(m.verts.data(), m.verts.size() * sizeof(vformat::vertex));
+        w.write(m.indices.data(), m.indices.size() * sizeof(uint32_t));
+
+        std::cout << "baked mesh " << path << ": " << m.verts.size() << " vertices\n";
+    }
+
+    // faces (or a single image) with every layer the same size
+    void bakeImage(writer& w, const std::string& name, const std::vector<image>& layers, bool mips) {
+        const uint32_t width = layers[0].width, height = layers[0].height;
+        const uint32_t levels = mips ? uint32_t(std::floor(std::log2(std::max(width, height)))) + 1 : 1;
+
+        pack::entry& e = w.begin(name, pack::kind::image);
+        e.info[0] = width;
+        e.info[1] = height;
+        e.info[2] = levels;
+        e.info[3] = layers.size();
+
+        std::vector<image> level = layers;
+        for (uint32_t l = 0; l < levels; l++) {
+            for (auto& img : level) {
+                w.write(img.rgba.data(), img.rgba.size());
+            }
+            if (l + 1 < levels) {
+                for (auto& img : level) {
+                    img = downsample(img);
+                }
+            }
+        }
+
+        std::cout << "baked image " << name << ": " << width << "x" << height << ", " << levels << " levels, " << layers.size() << " layers\n";
+    }
+
+    void bakeShader(writer& w, const std::string& path) {
+        io::mappedFile spv(path);
+
+        w.begin(path, pack::kind::shader);
+        w.write(spv.data(), spv.size());
+
+        std::cout << "baked shader " << path << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <output.pack>\n";
+        return 1;
+    }
+
+    try {
+        writer w(argv[1]);
+
+        bakeMesh(w, "models/vertical-quad.obj");
+        bakeMesh(w, "models/cube.obj");
+
+        // flipped the same way the app flips them when decoding at runtime
+        bakeImage(w, "textures/floor-diffuse-1k.jpg", {decode("textures/floor-diffuse-1k.jpg", false)}, true);
+        bakeImage(w, "textures/grass-billboard.png", {decode("textures/grass-billboard.png", true)}, true);
+
+        // same faces in the same order as the app
+        std::vector<image> faces;
+        for (std::string_view f : pack::cubemapFaces) {
+            faces.push_back(decode(std::string(f), false));
+        }
+        bakeImage(w, std::string(pack::cubemapName), faces, false);
+
+        // compiled shaders, "make spv" has to have run first
+        std::vector<std::string> spvs;
+        for (const auto& f : std::filesystem::directory_iterator(".spv")) {
+            if (f.path().extension() == ".spv") {
+                spvs.push_back(".spv/" + f.path().filename().string());
+            }
+        }
+        std::sort(spvs.begin(), spvs.end());
+        for (const auto& s : spvs) {
+            bakeShader(w, s);
+        }
+
+        w.finish(sizeof(vformat::vertex));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
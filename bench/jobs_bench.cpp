@@ -0,0 +1,72 @@
+// scheduling overhead of the job pool, run with `make bench`.
+// the jobs do no work, so the times are what submitting, queueing, stealing and waiting cost.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "jobs.hpp"
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    // best of a few runs, in nanoseconds per job
+    double measure(size_t jobs, const std::function<void()>& fn) {
+        double best = 1e30;
+        for (int run = 0; run < 5; run++) {
+            auto start = steady::now();
+            fn();
+            double ns = std::chrono::duration<double, std::nano>(steady::now() - start).count() / jobs;
+            best = std::min(best, ns);
+        }
+        return best;
+    }
+}
+
+int main() {
+    const size_t n = 100000;
+    jobs::pool p;
+    printf("%u workers, %zu jobs per run\n", p.size(), n);
+
+    // independent jobs submitted from outside the pool, so workers steal everything
+    double external = measure(n, [&] {
+        std::vector<jobs::handle> hs;
+        hs.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            hs.push_back(p.submit([] {}));
+        }
+        p.wait(hs);
+    });
+    printf("submit + wait (external): %8.1f ns/job\n", external);
+
+    // the same from inside a job, where submits go to the worker's own deque
+    double internal = measure(n, [&] {
+        p.wait(p.submit([&] {
+            std::vector<jobs::handle> hs;
+            hs.reserve(n);
+            for (size_t i = 0; i < n; i++) {
+                hs.push_back(p.submit([] {}));
+            }
+            p.wait(hs);
+        }));
+    });
+    printf("submit + wait (in job):   %8.1f ns/job\n", internal);
+
+    // a serial chain, each job waits on the one before it
+    double chain = measure(n, [&] {
+        jobs::handle prev;
+        for (size_t i = 0; i < n; i++) {
+            prev = p.submit([] {}, {prev});
+        }
+        p.wait(prev);
+    });
+    printf("dependency chain:         %8.1f ns/job\n", chain);
+
+    double pfor = measure(n, [&] { p.parallelFor(n, [](size_t) {}); });
+    printf("parallelFor:              %8.1f ns/job\n", pfor);
+
+    return 0;
+}
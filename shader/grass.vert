@@ -1,16 +1,13 @@
 #version 460
+#extension GL_GOOGLE_include_directive : require
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texcoord;
 
-layout (location = 3) in mat4 instance_model;
+layout (location = 3) in vec4 instance; // xyz position on the terrain, w yaw in radians (see scatter.comp)
 
-layout (set = 0, binding = 0, std140) uniform uniformBuffer {
-	mat4 model;
-	mat4 view;
-	mat4 proj;
-} ubo;
+#include "grass.glsl"
 
 layout (location = 0) out vec3 p;
 layout (location = 1) out vec3 n;
@@ -18,7 +15,12 @@ layout (location = 2) out vec2 uv;
 
 void main() {
 
-	vec4 p4 = instance_model * vec4(position, 1.0);
+	float s = sin(instance.w);
+	float c = cos(instance.w);
+	vec3 rotated = vec3(c * position.x + s * position.z, position.y, c * position.z - s * position.x);
+	vec4 p4 = vec4(rotated + instance.xyz, 1.0);
+	p4.xyz += bend(instance.xyz, position.y / modelHeight);
+	p4.xyz += trample(instance.xyz, position.y);
 
 	gl_Position = ubo.proj * ubo.view * p4;
 	
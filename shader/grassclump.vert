@@ -0,0 +1,62 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+// grass.vert for --grass-clump: each instance is a clump of blades around its position instead of the grass
+// model. there is no vertex buffer, every vertex is made up from gl_VertexIndex: blade gl_VertexIndex / 6,
+// then 2 vertices (left, right) per row for 3 rows from the root up. the index buffer (see
+// appvk::createClumpIndexBuffer) only strings those into quads, so any clump size draws with the same shader.
+
+layout (location = 0) in vec4 instance; // xyz clump center on the terrain, w yaw in radians (see scatter.comp)
+
+#include "grass.glsl"
+#include "hash.glsl"
+
+layout (location = 0) out vec3 p;
+layout (location = 1) out vec3 n;
+layout (location = 2) out vec2 uv;
+
+const uint bladeVertices = 6;
+const float clumpRadius = 0.3;
+const float bladeWidth = 0.5; // same card as the grass model's quads
+const float bladeHeight = 0.5;
+
+vec3 rotateY(vec3 v, float a) {
+	float s = sin(a);
+	float c = cos(a);
+	return vec3(c * v.x + s * v.z, v.y, c * v.z - s * v.x);
+}
+
+void main() {
+	uint blade = uint(gl_VertexIndex) / bladeVertices;
+	uint corner = uint(gl_VertexIndex) % bladeVertices;
+	float side = float(corner & 1u); // 0 left, 1 right
+	float row = float(corner >> 1u) * 0.5; // 0 root, 1 tip
+
+	// every vertex of a blade hashes to the same values
+	uint h = pcg(pcg(uint(gl_InstanceIndex)) + blade);
+	float angle = unorm(h) * 6.2831853;
+	h = pcg(h);
+	float radius = sqrt(unorm(h)) * clumpRadius; // uniform over the disc
+	h = pcg(h);
+	float yaw = unorm(h) * 6.2831853;
+	h = pcg(h);
+	float height = bladeHeight * (0.8 + 0.4 * unorm(h));
+	h = pcg(h);
+	float lean = 0.05 + 0.25 * unorm(h);
+
+	// leaning away from the clump center, more towards the tip
+	vec2 out2 = vec2(cos(angle), sin(angle));
+	vec3 local = rotateY(vec3((side - 0.5) * bladeWidth, row * height, 0.0), yaw);
+	local.xz += out2 * (radius + lean * row * row);
+	local.y -= lean * row * row * 0.5; // roughly keeps the blade's length while it bends
+
+	vec4 p4 = vec4(rotateY(local, instance.w) + instance.xyz, 1.0);
+	p4.xyz += bend(instance.xyz, row);
+	p4.xyz += trample(instance.xyz, row * height);
+
+	gl_Position = ubo.proj * ubo.view * p4;
+
+	p = p4.xyz;
+	n = vec3(0.0, 1.0, 0.0);
+	uv = vec2(side, row);
+}
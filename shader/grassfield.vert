@@ -0,0 +1,52 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+// grass.vert without an instance buffer (--grass=field). instance N is the blade in cell N of a
+// nearSide x nearSide window of the cells x cells grid over the terrain (the whole grid without impostors),
+// its jitter, yaw and scale are hashed from the cell and it stands on the heightmap, so nothing per blade
+// is stored anywhere and a blade looks the same wherever the window is. see appvk::grassFieldParams.
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texcoord;
+
+#include "grass.glsl"
+#include "field.glsl"
+#include "hash.glsl"
+
+layout (location = 0) out vec3 p;
+layout (location = 1) out vec3 n;
+layout (location = 2) out vec2 uv;
+
+void main() {
+	uvec2 xy = ubo.nearFirst + uvec2(uint(gl_InstanceIndex) % params.nearSide, uint(gl_InstanceIndex) / params.nearSide);
+	uint id = xy.y * params.cells + xy.x;
+	vec2 cell = vec2(xy);
+
+	uint h = pcg(id ^ params.seed);
+	float jx = unorm(h);
+	h = pcg(h);
+	float jz = unorm(h);
+	h = pcg(h);
+	float yaw = unorm(h) * 6.2831853;
+	h = pcg(h);
+	float scale = 0.75 + 0.5 * unorm(h);
+
+	// anywhere in the cell, so the grid doesn't show
+	vec2 xz = params.origin + (cell + vec2(jx, jz)) * (params.size / float(params.cells));
+	float y = textureLod(heightmap, (xz - params.origin) / params.size, 0.0).r;
+
+	float s = sin(yaw);
+	float c = cos(yaw);
+	vec3 rotated = vec3(c * position.x + s * position.z, position.y, c * position.z - s * position.x);
+	vec3 root = vec3(xz.x, y, xz.y);
+	vec4 p4 = vec4(rotated * scale + root, 1.0);
+	p4.xyz += bend(root, position.y / modelHeight);
+	p4.xyz += trample(root, position.y * scale);
+
+	gl_Position = ubo.proj * ubo.view * p4;
+
+	p = p4.xyz;
+	n = vec3(0.0, 1.0, 0.0);
+	uv = texcoord;
+}
@@ -0,0 +1,45 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+// grass.frag for impostor cards, see impostor.vert. the normal and coverage come from the atlas instead of the
+// blade, lighting is the same, so each quality tier and precision applies to cards as it does to blades.
+
+#include "shading.glsl"
+
+layout (location = 0) in vec3 p;
+layout (location = 1) in vec2 uv;
+layout (location = 2) flat in vec4 tile;
+
+// appvk::bakeImpostors
+layout (set = 0, binding = 5) uniform sampler2D impostorColor;
+layout (set = 0, binding = 6) uniform sampler2D impostorNormal; // xyz normal packed to 0-1, w coverage kept for the alpha test
+
+layout (location = 0) out vec4 fragcolor;
+
+void main() {
+	// smaller mips have bigger texels, keep the filter footprint of the coarser level used inside the view's tile so
+	// neighbouring views don't bleed in. the gradients still come from uv, the clamp would flatten them at the edges
+	float lod = textureQueryLod(impostorNormal, uv).x;
+	vec2 halfTexel = min(0.5 * exp2(ceil(lod)) / vec2(textureSize(impostorNormal, 0)), 0.5 * (tile.zw - tile.xy));
+	vec2 st = clamp(uv, tile.xy + halfTexel, tile.zw - halfTexel);
+	vec2 dx = dFdx(uv);
+	vec2 dy = dFdy(uv);
+
+	vec4 na = textureGrad(impostorNormal, st, dx, dy);
+	// coverage is filtered between covered and empty texels, half way keeps blades about as thick as they were baked.
+	// the mips scale it so distant cards keep as many texels as the full size, see coverageMips in impostor.cpp
+	if (na.a <= 0.5) {
+		discard;
+	}
+
+	// empty texels are cleared to 0, filtering would darken the color and shorten the normal at the edges otherwise.
+	// the color's alpha is the coverage actually filtered into both, the normal's is rescaled
+	vec4 col = textureGrad(impostorColor, st, dx, dy);
+	float coverage = max(col.a, 1.0 / 255.0);
+	vec3 raw = col.rgb / coverage;
+	vec3 n = na.xyz / coverage * 2.0 - 1.0;
+
+	PREC hvec3 c = phong(sceneLight(), hvec3(raw), p, n);
+
+	fragcolor = vec4(vec3(c), 1.0);
+}
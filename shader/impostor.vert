@@ -0,0 +1,60 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+// far field grass with --impostor-distance: instance N is the card for block N of the cards x cards blocks of
+// cardCells x cardCells field cells, 6 vertices each and no vertex buffer. a block wholly inside the window drawn as
+// blades (see grassfield.vert) collapses to nothing. the others face the baked view (see impostorbake.vert) closest
+// to the direction they are seen from, centered where the block's grass stands. cards and blades do overlap along
+// the window's edge: a block the edge cuts through is both a card and, inside the window, blades, and a card spans
+// its block's bounding sphere, so it reaches into its neighbours too. the depth test sorts that out and blades
+// there are far enough away for it not to show. wind and trampling don't reach cards, for the same reason.
+
+#include "uniforms.glsl"
+#include "field.glsl"
+#include "impostor.glsl"
+
+layout (location = 0) out vec3 p;
+layout (location = 1) out vec2 uv;
+layout (location = 2) flat out vec4 tile; // the view's corners in the atlas, see impostor.frag
+
+const vec2 corners[6] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+	uint cards = (params.cells + params.cardCells - 1) / params.cardCells;
+	uvec2 first = uvec2(uint(gl_InstanceIndex) % cards, uint(gl_InstanceIndex) / cards) * params.cardCells;
+	uvec2 last = min(first + params.cardCells, uvec2(params.cells)); // the last row and column can be cut short
+
+	if (all(greaterThanEqual(first, ubo.nearFirst)) && all(lessThanEqual(last, ubo.nearFirst + params.nearSide))) {
+		gl_Position = vec4(0.0); // degenerate, nothing is rasterized
+		return;
+	}
+
+	vec2 cellSize = params.size / float(params.cells);
+	vec2 xz = params.origin + 0.5 * vec2(first + last) * cellSize;
+	float y = textureLod(heightmap, (xz - params.origin) / params.size, 0.0).r;
+	vec3 center = vec3(xz.x, y + 0.5 * cardHeight, xz.y);
+
+	// closest baked direction, cards seen from below the horizon use the horizontal views
+	vec3 eye = -transpose(mat3(ubo.view)) * ubo.view[3].xyz;
+	vec3 d = normalize(eye - center);
+	float azimuthStep = 6.2831853 / float(azimuths);
+	uint k = uint(int(round(atan(d.x, d.z) / azimuthStep)) + int(azimuths)) % azimuths;
+	uint j = uint(clamp(round(asin(clamp(d.y, -1.0, 1.0)) / elevationStep), 0.0, float(elevations - 1)));
+
+	float a = float(k) * azimuthStep;
+	float e = float(j) * elevationStep;
+	vec3 toEye = vec3(cos(e) * sin(a), sin(e), cos(e) * cos(a));
+	vec3 right = vec3(cos(a), 0.0, -sin(a));
+	vec3 up = cross(toEye, right);
+
+	vec2 footprint = cellSize * float(params.cardCells);
+	float radius = 0.5 * length(vec3(footprint.x, cardHeight, footprint.y));
+	vec2 corner = corners[gl_VertexIndex];
+	vec4 p4 = vec4(center + (right * corner.x + up * corner.y) * radius, 1.0);
+
+	gl_Position = ubo.proj * ubo.view * p4;
+
+	p = p4.xyz;
+	uv = (vec2(k, j) + vec2(0.5 + 0.5 * corner.x, 0.5 - 0.5 * corner.y)) / vec2(azimuths, elevations);
+	tile = vec4(vec2(k, j), vec2(k, j) + 1.0) / vec2(azimuths, elevations).xyxy;
+}
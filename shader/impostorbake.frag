@@ -0,0 +1,27 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+// writes one baked view of the impostor atlas, see impostorbake.vert.
+// color is the grass texture as it is before lighting, normalAlpha the normal packed to 0-1 and coverage.
+// texels no blade covers keep the clear value, coverage 0. the bake sets no specialization constants, so
+// alphaCutoff is shading.glsl's default, which every tier uses.
+
+#include "shading.glsl"
+
+layout (location = 0) in vec3 n;
+layout (location = 1) in vec2 uv;
+
+layout (set = 0, binding = 1) uniform sampler2D tex;
+
+layout (location = 0) out vec4 color;
+layout (location = 1) out vec4 normalAlpha;
+
+void main() {
+	vec4 raw = texture(tex, uv);
+	if (raw.a <= alphaCutoff) {
+		discard;
+	}
+
+	color = vec4(raw.rgb, 1.0);
+	normalAlpha = vec4(normalize(n) * 0.5 + 0.5, 1.0);
+}
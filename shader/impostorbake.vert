@@ -0,0 +1,61 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+// draws the field grass of one impostor card into one view of the atlas, see appvk::bakeImpostors.
+// blades made the way grassfield.vert makes them over a cardCells x cardCells block of cells on flat ground, without
+// wind or trampling. each draw covers one view with firstInstance at view * blades, so instance N is blade N % blades of
+// view N / blades, and the viewport is that view's tile. the projection is orthographic, a cube around the card's
+// bounding sphere seen from the view's direction, which impostor.vert turns back into a card of the same size.
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texcoord;
+
+#include "field.glsl"
+#include "hash.glsl"
+#include "impostor.glsl"
+
+layout (location = 0) out vec3 n;
+layout (location = 1) out vec2 uv;
+
+void main() {
+	uint blades = params.cardCells * params.cardCells;
+	uint view = uint(gl_InstanceIndex) / blades;
+	uint blade = uint(gl_InstanceIndex) % blades;
+
+	// one representative block: every card shares the atlas, so the blade index within the block is hashed rather
+	// than the field cell id grassfield.vert hashes. a card shows grass like its block's, not those exact blades, and
+	// blades change where the blade window moves over them
+	uint h = pcg(blade ^ params.seed);
+	float jx = unorm(h);
+	h = pcg(h);
+	float jz = unorm(h);
+	h = pcg(h);
+	float yaw = unorm(h) * 6.2831853;
+	h = pcg(h);
+	float scale = 0.75 + 0.5 * unorm(h);
+
+	vec2 cellSize = params.size / float(params.cells);
+	vec2 footprint = cellSize * float(params.cardCells);
+	vec2 xz = (vec2(blade % params.cardCells, blade / params.cardCells) + vec2(jx, jz)) * cellSize - 0.5 * footprint;
+
+	float s = sin(yaw);
+	float c = cos(yaw);
+	vec3 rotated = vec3(c * position.x + s * position.z, position.y, c * position.z - s * position.x);
+	vec3 pos = rotated * scale + vec3(xz.x, 0.0, xz.y);
+
+	// the view's basis, impostor.vert builds the same one to place the card
+	float a = float(view % azimuths) * (6.2831853 / float(azimuths));
+	float e = float(view / azimuths) * elevationStep;
+	vec3 toEye = vec3(cos(e) * sin(a), sin(e), cos(e) * cos(a));
+	vec3 right = vec3(cos(a), 0.0, -sin(a));
+	vec3 up = cross(toEye, right);
+
+	vec3 rel = pos - vec3(0.0, 0.5 * cardHeight, 0.0);
+	float radius = 0.5 * length(vec3(footprint.x, cardHeight, footprint.y));
+	// top of the card at the top of the tile, nearer to the eye is less deep
+	gl_Position = vec4(dot(rel, right) / radius, -dot(rel, up) / radius, 0.5 - 0.5 * dot(rel, toEye) / radius, 1.0);
+
+	n = vec3(0.0, 1.0, 0.0); // what grassfield.vert lights blades with, so cards shade like the blades they stand in for
+	uv = texcoord;
+}
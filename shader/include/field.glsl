@@ -0,0 +1,17 @@
+#ifndef FIELD_GLSL
+#define FIELD_GLSL
+
+// appvk::grassFieldParams, the field grass grid
+layout (push_constant) uniform fieldParams {
+	vec2 origin;
+	vec2 size;
+	uint cells;
+	uint seed;
+	uint cardCells;
+	uint nearSide;
+} params;
+
+// terrain height over its xz bounds, sampled at texel centers
+layout (set = 0, binding = 2) uniform sampler2D heightmap;
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef GRASS_GLSL
+#define GRASS_GLSL
+
+// what moves blades around (wind and trampling), shared by every grass vertex shader
+
+#include "uniforms.glsl"
+
+const float modelHeight = 0.5; // models/vertical-quad.obj
+
+// bend at the tip of a blade, rewritten every frame by wind.comp
+layout (set = 0, binding = 3) uniform sampler2D windField;
+const float windExtent = 64.0; // world units the field covers, centered on the origin
+
+// tips move with the wind, roots stay put
+vec3 bend(vec3 pos, float tip) {
+	vec2 wind = textureLod(windField, pos.xz / windExtent + 0.5, 0.0).xy * ubo.windStrength;
+	float k = tip * tip;
+	return vec3(wind.x * k, -0.5 * dot(wind, wind) * k, wind.y * k); // drops a little so the blade doesn't stretch
+}
+
+// how flat the grass is trampled, see trample.comp
+layout (set = 0, binding = 4) uniform sampler2D trampleField;
+
+// pushed over away from whatever trampled it, by h, the height of the vertex above the root
+vec3 trample(vec3 root, float h) {
+	vec3 d = textureLod(trampleField, (root.xz - ubo.trampleBounds.xy) / ubo.trampleBounds.zw, 0.0).xyz;
+	return vec3(d.x * h, -0.8 * d.z * h, d.y * h);
+}
+
+#endif
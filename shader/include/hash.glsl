@@ -0,0 +1,16 @@
+#ifndef HASH_GLSL
+#define HASH_GLSL
+
+// pcg hash, everything that places grass by hashing an index uses this one so the results line up
+uint pcg(uint v) {
+	uint state = v * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// 0 to 1 from the top 24 bits of a hash
+float unorm(uint h) {
+	return float(h >> 8) / 16777216.0;
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef IMPOSTOR_GLSL
+#define IMPOSTOR_GLSL
+
+// layout of the impostor atlas, set by appvk::impostorSpecInfo for impostor.vert and impostorbake.vert.
+// views are azimuths around the card along x, elevations from the horizon up along y.
+layout (constant_id = 0) const uint azimuths = 8; // appvk::impostorAzimuths
+layout (constant_id = 1) const uint elevations = 3; // appvk::impostorElevations
+layout (constant_id = 2) const float cardHeight = 0.625; // appvk::impostorCardHeight
+const float elevationStep = radians(30.0); // between elevations, the first is the horizon
+
+#endif
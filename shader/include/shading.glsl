@@ -0,0 +1,78 @@
+#ifndef SHADING_GLSL
+#define SHADING_GLSL
+
+// lighting shared by terrain.frag, grass.frag and impostor.frag, so cards shade like the blades they stand in for.
+// include before anything else, the half precision extension has to come first.
+
+// precision variants, built from one source by shader/makefile (see appvk::fragPrecision).
+// HALF_SHADING does the color math in fp16, RELAXED_SHADING marks it mediump, which drivers may or may not
+// lower. positions stay fp32 either way, distances in world units overflow half.
+#if defined(HALF_SHADING)
+#extension GL_EXT_shader_explicit_arithmetic_types_float16 : require
+#define PREC
+#define hfloat float16_t
+#define hvec3 f16vec3
+#elif defined(RELAXED_SHADING)
+#define PREC mediump
+#define hfloat float
+#define hvec3 vec3
+#else
+#define PREC
+#define hfloat float
+#define hvec3 vec3
+#endif
+
+// set per quality tier by appvk::createGraphicsPipeline (see appvk::shadingConstants), the defaults are the high tier
+layout (constant_id = 0) const float lightX = 0.0;
+layout (constant_id = 1) const float lightY = 10.0;
+layout (constant_id = 2) const float lightZ = -12.0;
+layout (constant_id = 3) const float lightR = 0.5;
+layout (constant_id = 4) const float lightG = 0.5;
+layout (constant_id = 5) const float lightB = 0.5;
+layout (constant_id = 6) const float falloffConstant = 1.0;
+layout (constant_id = 7) const float falloffLinear = 0.0;
+layout (constant_id = 8) const float falloffQuadratic = 0.0;
+layout (constant_id = 9) const float alphaCutoff = 0.9;
+layout (constant_id = 10) const bool diffuseLighting = true; // false shades with the light's average contribution
+
+struct point {
+	vec3 p;
+	vec3 color;
+};
+
+// color c at position p with normal n
+PREC hvec3 phong(in point l, in PREC hvec3 c, in vec3 p, in vec3 n) {
+	vec3 ldir = l.p - p;
+	
+	float dist = length(ldir);
+
+	vec3 cf = vec3(falloffConstant, falloffLinear, falloffQuadratic);
+	PREC hfloat falloff = hfloat(cf.x + (cf.y / dist) + (cf.z / (dist * dist)));
+	ldir /= dist;
+
+	PREC hvec3 nn = normalize(hvec3(n));
+
+	PREC hfloat diff = diffuseLighting ? clamp(dot(hvec3(ldir), nn), hfloat(0.0), hfloat(1.0)) : hfloat(0.5);
+
+	PREC hvec3 amb = hfloat(0.15) * c;
+	PREC hvec3 diffc = mix(amb, c * hvec3(l.color), diff);
+
+	/*
+	vec3 eyedir = normalize(eye - p);
+	float spec = clamp(dot(reflect(-ldir, nn), eyedir), 0.0, 1.0);
+	spec = pow(spec, 150);
+
+	vec3 specc = l.color * spec;
+
+	return (diffc + specc) * falloff;
+	*/
+	
+	return diffc * falloff;
+}
+
+// the scene's one light, at the current tier's position and color
+point sceneLight() {
+	return point(vec3(lightX, lightY, lightZ), vec3(lightR, lightG, lightB));
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef TRAMPLE_GLSL
+#define TRAMPLE_GLSL
+
+// what trample.comp and recover.comp share, see appvk::recordTrample
+
+struct contact {
+	vec4 shape; // xy center on the xz plane, z radius, w strength
+	ivec4 rect; // first texel, then width and height
+};
+
+// appvk::trampleFrame
+layout (set = 0, binding = 0, std430) readonly buffer trampleFrame {
+	uint stamp[3];
+	uint recover[3];
+	float recovered; // flatness regained since the last frame
+	uint contactCount;
+	vec4 bounds; // xz origin and size of the field
+	contact contacts[256]; // appvk::maxContacts
+	uvec2 tiles[1024]; // appvk::trampleTiles squared
+} frame;
+
+// xy push direction scaled by z, z how flat, 0 upright to 1 flat
+layout (set = 0, binding = 1, rgba16f) uniform image2D trampleField;
+
+#endif
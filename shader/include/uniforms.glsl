@@ -0,0 +1,15 @@
+#ifndef UNIFORMS_GLSL
+#define UNIFORMS_GLSL
+
+// appvk::mvp, updated every frame
+layout (set = 0, binding = 0, std140) uniform uniformBuffer {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+	float time;
+	float windStrength;
+	vec4 trampleBounds; // xz origin and size of the trample field
+	uvec2 nearFirst; // first field grass cell of the window drawn as blades
+} ubo;
+
+#endif
@@ -0,0 +1,195 @@
+// Replaces the global allocation functions so that heap traffic inside the frame loop can be found.
+// The steady-state loop is supposed to be allocation-free: allocator jitter shows up as frame time spikes.
+// Only built with "make alloc" (-DTRACK_ALLOCS), everything here is glibc-specific.
+#ifdef TRACK_ALLOCS
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include <execinfo.h> // backtrace
+#include <unistd.h> // STDERR_FILENO
+
+#include "alloc_track.hpp"
+
+// the real allocator, exported by glibc
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t n, size_t size);
+    void* __libc_realloc(void* p, size_t size);
+    void* __libc_memalign(size_t align, size_t size);
+    void __libc_free(void* p);
+}
+
+namespace {
+    // swapchain creation, pipeline compilation, first-use driver paths, etc. all allocate for a while
+    constexpr uint64_t warmupFrames = 120;
+
+    // keep every stack until half the table is full, then only every sampleEvery'th one
+    constexpr size_t maxSamples = 32;
+    constexpr uint64_t sampleEvery = 64;
+    constexpr int maxDepth = 24;
+
+    struct sample {
+        uint64_t frame;
+        size_t size;
+        const char* kind;
+        int depth;
+        void* pcs[maxDepth];
+    };
+
+    // no heap allowed in here, everything is fixed-size
+    sample samples[maxSamples];
+    std::atomic<size_t> numSamples{0};
+
+    std::atomic<uint64_t> frame{0};
+    std::atomic<uint64_t> allocs{0};
+    std::atomic<uint64_t> allocBytes{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> dirtyFrames{0};
+
+    thread_local bool inFrame = false;
+    thread_local bool inHook = false; // backtrace() may allocate itself
+    thread_local uint64_t allocsThisFrame = 0;
+
+    bool tracking() {
+        return inFrame && !inHook && frame.load(std::memory_order_relaxed) > warmupFrames;
+    }
+
+    void recordAlloc(size_t size, const char* kind) {
+        if (!tracking()) {
+            return;
+        }
+        inHook = true;
+
+        allocsThisFrame++;
+        uint64_t n = allocs.fetch_add(1, std::memory_order_relaxed);
+        allocBytes.fetch_add(size, std::memory_order_relaxed);
+
+        if (n < maxSamples / 2 || n % sampleEvery == 0) {
+            size_t slot = numSamples.fetch_add(1, std::memory_order_relaxed);
+            if (slot < maxSamples) {
+                sample& s = samples[slot];
+                s.frame = frame.load(std::memory_order_relaxed);
+                s.size = size;
+                s.kind = kind;
+                s.depth = backtrace(s.pcs, maxDepth);
+            }
+        }
+
+        inHook = false;
+    }
+
+    void recordFree(void* p) {
+        if (p && tracking()) {
+            frees.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void* newImpl(size_t size, const char* kind) {
+        recordAlloc(size, kind);
+        void* p = __libc_malloc(size ? size : 1);
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+}
+
+void atrack::beginFrame() {
+    static bool warm = false;
+    if (!warm) {
+        // the first backtrace() call loads libgcc and allocates, get that out of the way now
+        void* pc;
+        inHook = true;
+        backtrace(&pc, 1);
+        inHook = false;
+        warm = true;
+    }
+
+    frame.fetch_add(1, std::memory_order_relaxed);
+    allocsThisFrame = 0;
+    inFrame = true;
+}
+
+void atrack::endFrame() {
+    inFrame = false;
+    if (allocsThisFrame > 0) {
+        dirtyFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void atrack::report() {
+    const uint64_t total = frame.load();
+    const uint64_t tracked = total > warmupFrames ? total - warmupFrames : 0;
+
+    std::cerr << "allocation report: " << tracked << " frames tracked after " << warmupFrames << " warm-up frames\n";
+    std::cerr << "\t" << allocs.load() << " allocations (" << allocBytes.load() << " bytes), "
+        << frees.load() << " frees, " << dirtyFrames.load() << " frames allocated\n";
+
+    const size_t n = std::min(numSamples.load(), maxSamples);
+    for (size_t i = 0; i < n; i++) {
+        const sample& s = samples[i];
+        std::cerr << "sample " << i << ": " << s.kind << " of " << s.size << " bytes in frame " << s.frame << "\n";
+        std::cerr.flush();
+        backtrace_symbols_fd(s.pcs, s.depth, STDERR_FILENO); // writes directly to the fd, no malloc
+    }
+}
+
+extern "C" {
+    void* malloc(size_t size) noexcept {
+        recordAlloc(size, "malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t n, size_t size) noexcept {
+        recordAlloc(n * size, "calloc");
+        return __libc_calloc(n, size);
+    }
+
+    void* realloc(void* p, size_t size) noexcept {
+        recordAlloc(size, "realloc");
+        return __libc_realloc(p, size);
+    }
+
+    void* aligned_alloc(size_t align, size_t size) noexcept {
+        recordAlloc(size, "aligned_alloc");
+        return __libc_memalign(align, size);
+    }
+
+    int posix_memalign(void** p, size_t align, size_t size) noexcept {
+        recordAlloc(size, "posix_memalign");
+        *p = __libc_memalign(align, size);
+        return *p ? 0 : ENOMEM;
+    }
+
+    void free(void* p) noexcept {
+        recordFree(p);
+        __libc_free(p);
+    }
+}
+
+// operator new goes straight to glibc so it isn't counted a second time by the malloc hook
+void* operator new(size_t size) { return newImpl(size, "new"); }
+void* operator new[](size_t size) { return newImpl(size, "new[]"); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    recordAlloc(size, "new");
+    return __libc_malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    recordAlloc(size, "new[]");
+    return __libc_malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { recordFree(p); __libc_free(p); }
+void operator delete[](void* p) noexcept { recordFree(p); __libc_free(p); }
+void operator delete(void* p, size_t) noexcept { recordFree(p); __libc_free(p); }
+void operator delete[](void* p, size_t) noexcept { recordFree(p); __libc_free(p); }
+
+#endif
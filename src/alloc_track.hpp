@@ -0,0 +1,19 @@
+#pragma once
+
+// heap allocation tracking for the render loop, only compiled in with "make alloc".
+// every other build gets empty inline functions so the calls in the frame loop cost nothing.
+namespace atrack {
+#ifdef TRACK_ALLOCS
+    // mark the start and end of a frame on the calling thread.
+    // allocations made on that thread in between are attributed to the frame.
+    void beginFrame();
+    void endFrame();
+
+    // print allocation counts and sampled call stacks to stderr
+    void report();
+#else
+    inline void beginFrame() {}
+    inline void endFrame() {}
+    inline void report() {}
+#endif
+}
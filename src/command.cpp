@@ -13,6 +13,10 @@ void appvk::createCommandPool() {
 }
 
 VkCommandBuffer appvk::beginSingleCommand() {
+    if (uploadCmd != VK_NULL_HANDLE) {
+        return uploadCmd; // recorded into the open batch instead
+    }
+
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = cp;
@@ -33,6 +37,10 @@ VkCommandBuffer appvk::beginSingleCommand() {
 }
 
 void appvk::endSingleCommand(VkCommandBuffer buf) {
+    if (buf == uploadCmd) {
+        return; // submitted with the rest of the batch
+    }
+
     vkEndCommandBuffer(buf);
 
     VkSubmitInfo subInfo{};
@@ -46,6 +54,47 @@ void appvk::endSingleCommand(VkCommandBuffer buf) {
     vkFreeCommandBuffers(dev, cp, 1, &buf);
 }
 
+// until submitUploadBatch(), every single-use command is recorded into one command buffer,
+// so a whole set of uploads costs one submit and one wait instead of several per asset
+void appvk::beginUploadBatch() {
+    uploadCmd = beginSingleCommand();
+}
+
+void appvk::submitUploadBatch() {
+    VkCommandBuffer buf = uploadCmd;
+    uploadCmd = VK_NULL_HANDLE;
+    endSingleCommand(buf);
+
+    for (auto [sbuf, smem] : pendingStaging) {
+        freeMemory(smem);
+        vkDestroyBuffer(dev, sbuf, nullptr);
+    }
+    pendingStaging.clear();
+}
+
+// drops an open batch without running it, for when setup fails partway through the uploads
+void appvk::discardUploadBatch() {
+    vkEndCommandBuffer(uploadCmd);
+    vkFreeCommandBuffers(dev, cp, 1, &uploadCmd);
+    uploadCmd = VK_NULL_HANDLE;
+
+    for (auto [sbuf, smem] : pendingStaging) {
+        freeMemory(smem);
+        vkDestroyBuffer(dev, sbuf, nullptr);
+    }
+    pendingStaging.clear();
+}
+
+// staging buffers have to live until the copies out of them have run
+void appvk::releaseStaging(VkBuffer buf, VkDeviceMemory m) {
+    if (uploadCmd != VK_NULL_HANDLE) {
+        pendingStaging.emplace_back(buf, m);
+        return;
+    }
+    freeMemory(m);
+    vkDestroyBuffer(dev, buf, nullptr);
+}
+
 // need to create a command buffer per swapchain image
 void appvk::allocRenderCmdBuffers() {
     commandBuffers.resize(swapFramebuffers.size());
@@ -61,6 +110,8 @@ void appvk::allocRenderCmdBuffers() {
         throw std::runtime_error("cannot create command buffers!");
     }
 
+    gpuTimes.create(commandBuffers.size());
+
     for (size_t i = 0; i < commandBuffers.size(); i++) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -68,52 +119,167 @@ void appvk::allocRenderCmdBuffers() {
             throw std::runtime_error("cannot begin recording command buffers!");
         }
 
-        VkRenderPassBeginInfo rBeginInfo{};
-        rBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        rBeginInfo.renderPass = renderPass;
-        rBeginInfo.framebuffer = swapFramebuffers[i];
-        rBeginInfo.renderArea.offset = { 0, 0 };
-        rBeginInfo.renderArea.extent = swapExtent;
-
-        VkClearValue attachClearValues[2];
-        attachClearValues[0].color = { { 0.15, 0.15, 0.15, 1.0 } };
-        attachClearValues[1].depthStencil = {1.0, 0};
-        
-        rBeginInfo.clearValueCount = 2;
-        rBeginInfo.pClearValues = attachClearValues;
-
         auto& cbuf = commandBuffers[i];
-        
-        // commands here respect submission order, but draw command pipeline stages can go out of order
-        vkCmdBeginRenderPass(cbuf, &rBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-        
-            VkDeviceSize offset[] = { 0 };
-            vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, terrainPipe);
-            vkCmdBindVertexBuffers(cbuf, 0, 1, &terrainVertBuf, offset);
-            vkCmdBindIndexBuffer(cbuf, terrainIndBuf, 0, VK_INDEX_TYPE_UINT32);
-            vkCmdBindDescriptorSets(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, terrainPipeLayout, 0, 1, &terrainSet[i], 0, nullptr);
-            vkCmdDrawIndexed(cbuf, terrainIndices, 1, 0, 0, 0);
-
-            VkDeviceSize offsets[] = { 0, 0 };
-            VkBuffer bufs[] = {grassVertBuf, grassVertInstBuf};
-            vkCmdNextSubpass(cbuf, VK_SUBPASS_CONTENTS_INLINE);
-
-            vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, grassPipe);
-            vkCmdBindVertexBuffers(cbuf, 0, 2, bufs, offsets);
-            vkCmdBindDescriptorSets(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, terrainPipeLayout, 0, 1, &grassSet[i], 0, nullptr);
-            vkCmdDraw(cbuf, grassVertices, grassInstances, 0, 0);
 
-            vkCmdNextSubpass(cbuf, VK_SUBPASS_CONTENTS_INLINE);
+        gpuTimes.reset(cbuf, i);
+        gpuTimes.begin(cbuf, i, windZone); // written even with wind off, results are only read if every zone has them
+        recordWind(cbuf, i);
+        gpuTimes.end(cbuf, i, windZone);
 
-            vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, skyPipe);
-            vkCmdBindVertexBuffers(cbuf, 0, 1, &skyVertBuf, offset);
-            vkCmdBindDescriptorSets(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, skyPipeLayout, 0, 1, &skySet[i], 0, nullptr);
-            vkCmdDraw(cbuf, skyVertices, 1, 0, 0);
+        gpuTimes.begin(cbuf, i, trampleZone);
+        recordTrample(cbuf, i);
+        gpuTimes.end(cbuf, i, trampleZone);
 
-        vkCmdEndRenderPass(cbuf);
+        gpuTimes.begin(cbuf, i, frameZone);
+        recordScene(cbuf, i, swapFramebuffers[i]);
+        gpuTimes.end(cbuf, i, frameZone);
         
         if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
             throw std::runtime_error("cannot record into command buffer!");
         }
     }
-}
\ No newline at end of file
+}
+
+void appvk::recordScene(VkCommandBuffer cbuf, size_t i, VkFramebuffer fb) {
+    VkRenderPassBeginInfo rBeginInfo{};
+    rBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    rBeginInfo.renderPass = renderPass;
+    rBeginInfo.framebuffer = fb;
+    rBeginInfo.renderArea.offset = { 0, 0 };
+    rBeginInfo.renderArea.extent = swapExtent;
+
+    VkClearValue attachClearValues[2];
+    attachClearValues[0].color = { { 0.15, 0.15, 0.15, 1.0 } };
+    attachClearValues[1].depthStencil = {1.0, 0};
+    
+    rBeginInfo.clearValueCount = 2;
+    rBeginInfo.pClearValues = attachClearValues;
+
+    // commands here respect submission order, but draw command pipeline stages can go out of order
+    vkCmdBeginRenderPass(cbuf, &rBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    
+        VkDeviceSize offset[] = { 0 };
+        vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, terrainPipe);
+        vkCmdBindVertexBuffers(cbuf, 0, 1, &terrainVertBuf, offset);
+        vkCmdBindIndexBuffer(cbuf, terrainIndBuf, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindDescriptorSets(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, terrainPipeLayout, 0, 1, &terrainSet[i], 0, nullptr);
+        vkCmdDrawIndexed(cbuf, terrainIndices, 1, 0, 0, 0);
+
+        VkDeviceSize offsets[] = { 0, 0 };
+        VkBuffer bufs[] = {grassVertBuf, grassVertInstBuf};
+        vkCmdNextSubpass(cbuf, VK_SUBPASS_CONTENTS_INLINE);
+
+        vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, grassPipe);
+        vkCmdBindDescriptorSets(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, grassPipeLayout, 0, 1, &grassSet[i], 0, nullptr);
+        if (settings.grassMode == options::grass::field) {
+            // every blade is placed by the vertex shader, see grassfield.vert
+            vkCmdBindVertexBuffers(cbuf, 0, 1, &grassVertBuf, offset);
+            vkCmdPushConstants(cbuf, grassPipeLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(grassField), &grassField);
+            vkCmdDraw(cbuf, grassVertices, grassField.nearSide * grassField.nearSide, 0, 0); // the window around the camera
+
+            if (impostors) {
+                // a card per block of cells, those inside the window collapse, see impostor.vert. same layout, so
+                // the grass set and field parameters stay bound
+                const uint32_t cards = (grassField.cells + grassField.cardCells - 1) / grassField.cardCells;
+                vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, impostorPipe);
+                vkCmdDraw(cbuf, 6, cards * cards, 0, 0);
+            }
+        } else if (settings.grassClump > 1) {
+            // blades come from the index pattern alone, see grassclump.vert
+            vkCmdBindVertexBuffers(cbuf, 0, 1, &grassVertInstBuf, offset);
+            vkCmdBindIndexBuffer(cbuf, clumpIndBuf, 0, VK_INDEX_TYPE_UINT16);
+            vkCmdDrawIndexedIndirect(cbuf, grassDrawBuf, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+        } else {
+            vkCmdBindVertexBuffers(cbuf, 0, 2, bufs, offsets);
+            vkCmdDrawIndirect(cbuf, grassDrawBuf, 0, 1, sizeof(VkDrawIndirectCommand)); // instance count comes from scatterGrass()
+        }
+
+        vkCmdNextSubpass(cbuf, VK_SUBPASS_CONTENTS_INLINE);
+
+        vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, skyPipe);
+        vkCmdBindVertexBuffers(cbuf, 0, 1, &skyVertBuf, offset);
+        vkCmdBindDescriptorSets(cbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, skyPipeLayout, 0, 1, &skySet[i], 0, nullptr);
+        vkCmdDraw(cbuf, skyVertices, 1, 0, 0);
+
+    vkCmdEndRenderPass(cbuf);
+}
+
+// renders the scene from cam into an offscreen copy of the swapchain image and reads it back, 4 bytes per pixel.
+// waits for the GPU to go idle twice, so it's only for checks, not for frames that get presented.
+std::vector<uint8_t> appvk::captureFrame(const cameraState& cam) {
+    waitForFrame(submittedSerial); // the attachments and image 0's uniforms are shared with presented frames
+
+    VkImage image;
+    VkDeviceMemory imageMem;
+    createImage(swapExtent.width, swapExtent.height, swapFormat, 1, VK_SAMPLE_COUNT_1_BIT,
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mem::attachment, image, imageMem);
+    VkImageView view = createImageView(image, swapFormat, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // same attachments as the swapchain framebuffers, with the resolve going to the offscreen image
+    VkImageView attachments[] = { msImageView, depthView, view };
+
+    VkFramebufferCreateInfo fCreateInfo{};
+    fCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    fCreateInfo.renderPass = renderPass;
+    fCreateInfo.attachmentCount = 3;
+    fCreateInfo.pAttachments = attachments;
+    fCreateInfo.width = swapExtent.width;
+    fCreateInfo.height = swapExtent.height;
+    fCreateInfo.layers = 1;
+
+    VkFramebuffer fb;
+    if (vkCreateFramebuffer(dev, &fCreateInfo, nullptr, &fb) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create framebuffer!");
+    }
+
+    const VkDeviceSize size = VkDeviceSize(swapExtent.width) * swapExtent.height * 4;
+    VkBuffer buf;
+    VkDeviceMemory bufMem;
+    createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mem::staging, buf, bufMem);
+
+    updateUniformBuffer(0, cam);
+
+    VkCommandBuffer cmd = beginSingleCommand();
+    recordScene(cmd, 0, fb);
+
+    // the render pass leaves the resolve target ready to present
+    VkImageMemoryBarrier toCopy{};
+    toCopy.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toCopy.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toCopy.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toCopy.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    toCopy.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toCopy.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toCopy.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toCopy.image = image;
+    toCopy.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toCopy);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { swapExtent.width, swapExtent.height, 1 };
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buf, 1, &region);
+
+    VkMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, nullptr, 0, nullptr);
+
+    endSingleCommand(cmd);
+
+    void* data;
+    vkMapMemory(dev, bufMem, 0, size, 0, &data);
+    std::vector<uint8_t> pixels(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    vkUnmapMemory(dev, bufMem);
+
+    vkDestroyBuffer(dev, buf, nullptr);
+    freeMemory(bufMem);
+    vkDestroyFramebuffer(dev, fb, nullptr);
+    vkDestroyImageView(dev, view, nullptr);
+    vkDestroyImage(dev, image, nullptr);
+    freeMemory(imageMem);
+
+    return pixels;
+}
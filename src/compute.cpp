@@ -0,0 +1,330 @@
+#include <cstddef>
+
+#include "main.hpp"
+
+// compute pipelines are only ever built one at a time, so they skip the worker pool
+vkr::pipeline appvk::createComputePipeline(std::string_view shader, VkPipelineLayout layout) {
+    VkComputePipelineCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    createInfo.stage.module = loadShaderModule(shader);
+    createInfo.stage.pName = "main";
+    createInfo.layout = layout;
+
+    VkPipeline pipe;
+    if (vkCreateComputePipelines(dev, pipeCache, 1, &createInfo, nullptr, &pipe) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create compute pipeline!");
+    }
+    return vkr::pipeline(dev, pipe);
+}
+
+// fills grassVertInstBuf and the instance count of grassDrawBuf on the GPU, see shader/scatter.comp.
+// runs once, after the terrain buffers are uploaded, and waits for the result.
+void appvk::scatterGrass(VkImageView density, VkSampler densitySamp) {
+    const uint32_t triangles = t.indices.size() / 3;
+    const uint32_t perTriangle = (settings.grassPerTriangle + settings.grassClump - 1) / settings.grassClump; // about as many blades with clumps
+    grassCandidates = triangles * perTriangle;
+
+    // every candidate might be kept, so the instance buffer has room for all of them
+    createBuffer(VkDeviceSize(grassCandidates) * sizeof(glm::vec4), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mem::instance, grassVertInstBuf, grassVertInstMem);
+
+    // the instance count is the second member of both, which is all the shader touches
+    const VkBufferUsageFlags drawUsage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (settings.grassClump > 1) {
+        const VkDrawIndexedIndirectCommand draw = { clumpIndices, 0, 0, 0, 0 };
+        std::tie(grassDrawBuf, grassDrawMem) = createUploadBuffer(&draw, sizeof(draw), drawUsage, mem::instance);
+    } else {
+        const VkDrawIndirectCommand draw = { grassVertices, 0, 0, 0 };
+        std::tie(grassDrawBuf, grassDrawMem) = createUploadBuffer(&draw, sizeof(draw), drawUsage, mem::instance);
+    }
+
+    // the density map covers the terrain's bounds exactly
+    struct scatterParams {
+        glm::vec2 origin;
+        glm::vec2 size;
+        uint32_t triangles;
+        uint32_t perTriangle;
+        uint32_t seed;
+    } params{terrainOrigin, terrainSize, triangles, perTriangle, 0x2545f491};
+
+    VkDescriptorSetLayoutBinding bindings[5] = {};
+    const VkDescriptorType types[5] = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // terrain vertices
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // terrain indices
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, // density
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // instances
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // draw command
+    };
+    for (uint32_t i = 0; i < 5; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = types[i];
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.bindingCount = 5;
+    setLayoutInfo.pBindings = bindings;
+
+    VkDescriptorSetLayout rawSetLayout;
+    if (vkCreateDescriptorSetLayout(dev, &setLayoutInfo, nullptr, &rawSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create scatter descriptor set!");
+    }
+    vkr::descriptorSetLayout setLayout(dev, rawSetLayout);
+
+    VkPushConstantRange push{};
+    push.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push.size = sizeof(params);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &rawSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &push;
+
+    VkPipelineLayout rawLayout;
+    if (vkCreatePipelineLayout(dev, &layoutInfo, nullptr, &rawLayout) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create scatter layout!");
+    }
+    vkr::pipelineLayout layout(dev, rawLayout);
+
+    vkr::pipeline pipe = createComputePipeline(".spv/scatter.comp.spv", layout);
+
+    VkDescriptorPoolSize poolSizes[2] = {
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 },
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    VkDescriptorPool rawPool;
+    if (vkCreateDescriptorPool(dev, &poolInfo, nullptr, &rawPool) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create scatter descriptor pool!");
+    }
+    vkr::descriptorPool pool(dev, rawPool);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &rawSetLayout;
+
+    VkDescriptorSet set;
+    if (vkAllocateDescriptorSets(dev, &allocInfo, &set) != VK_SUCCESS) {
+        throw std::runtime_error("cannot allocate scatter descriptor set!");
+    }
+
+    const VkDescriptorBufferInfo bufInfos[4] = {
+        { terrainVertBuf, 0, VK_WHOLE_SIZE },
+        { terrainIndBuf, 0, VK_WHOLE_SIZE },
+        { grassVertInstBuf, 0, VK_WHOLE_SIZE },
+        { grassDrawBuf, 0, VK_WHOLE_SIZE },
+    };
+    const VkDescriptorImageInfo imageInfo = { densitySamp, density, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+    VkWriteDescriptorSet writes[5] = {};
+    for (uint32_t i = 0; i < 5; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = types[i];
+    }
+    writes[0].pBufferInfo = &bufInfos[0];
+    writes[1].pBufferInfo = &bufInfos[1];
+    writes[2].pImageInfo = &imageInfo;
+    writes[3].pBufferInfo = &bufInfos[2];
+    writes[4].pBufferInfo = &bufInfos[3];
+    vkUpdateDescriptorSets(dev, 5, writes, 0, nullptr);
+
+    VkCommandBuffer cmd = beginSingleCommand();
+
+    // the uploads were a separate submission, their copies have to land before the shader reads
+    VkMemoryBarrier uploaded{};
+    uploaded.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    uploaded.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    uploaded.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &uploaded, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipe);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &set, 0, nullptr);
+    vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+    vkCmdDispatch(cmd, (triangles + 63) / 64, 1, 1);
+
+    VkMemoryBarrier scattered{};
+    scattered.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    scattered.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    scattered.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0, 1, &scattered, 0, nullptr, 0, nullptr);
+
+    endSingleCommand(cmd); // waits, so everything above can go out of scope
+
+    cout << "scattered up to " << grassCandidates << " grass instances over " << triangles << " terrain triangles";
+    if (settings.grassClump > 1) {
+        cout << ", " << settings.grassClump << " blades each";
+    }
+    cout << "\n";
+}
+
+// quads of clumpBladeVertices vertices each, laid out in rows of two from the root up (see grassclump.vert)
+void appvk::createClumpIndexBuffer() {
+    std::vector<uint16_t> indices;
+    indices.reserve(settings.grassClump * clumpBladeIndices);
+    for (uint16_t blade = 0; blade < settings.grassClump; blade++) {
+        const uint16_t base = blade * clumpBladeVertices;
+        for (uint16_t row = 0; row < 2; row++) {
+            const uint16_t v = base + row * 2;
+            indices.insert(indices.end(), { v, uint16_t(v + 1), uint16_t(v + 2), uint16_t(v + 1), uint16_t(v + 3), uint16_t(v + 2) });
+        }
+    }
+    clumpIndices = indices.size();
+    std::tie(clumpIndBuf, clumpIndMem) = createUploadBuffer(indices.data(), indices.size() * sizeof(uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, mem::index);
+}
+
+// the field image, and the pipeline that rewrites it every frame (see recordWind)
+void appvk::createWind() {
+    createImage(windSize, windSize, VK_FORMAT_R16G16B16A16_SFLOAT, 1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        mem::texture, windImage, windMem);
+    transitionImageLayout(windImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1, 1);
+
+    // still air until the first frame's dispatch, frames rendered without one (captureFrame) sample this
+    VkCommandBuffer cmd = beginSingleCommand();
+    const VkClearColorValue still{};
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+    vkCmdClearColorImage(cmd, windImage, VK_IMAGE_LAYOUT_GENERAL, &still, 1, &range);
+
+    VkMemoryBarrier cleared{};
+    cleared.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cleared.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    cleared.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &cleared, 0, nullptr, 0, nullptr);
+    endSingleCommand(cmd);
+
+    windView = createImageView(windImage, VK_FORMAT_R16G16B16A16_SFLOAT, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+    windSamp = createSampler(1);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &windSetLayout;
+
+    VkPipelineLayout rawLayout;
+    if (vkCreatePipelineLayout(dev, &layoutInfo, nullptr, &rawLayout) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create wind layout!");
+    }
+    windPipeLayout = vkr::pipelineLayout(dev, rawLayout);
+    windPipe = createComputePipeline(".spv/wind.comp.spv", windPipeLayout);
+}
+
+// recorded ahead of the render pass into every frame's command buffer. with wind off nothing is dispatched,
+// the uniform buffer's windStrength keeps the grass from bending to whatever the field last held.
+void appvk::recordWind(VkCommandBuffer cbuf, size_t i) {
+    if (!windOn) {
+        return;
+    }
+
+    // the previous frame's grass may still be reading the field
+    vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_COMPUTE, windPipe);
+    vkCmdBindDescriptorSets(cbuf, VK_PIPELINE_BIND_POINT_COMPUTE, windPipeLayout, 0, 1, &windSet[i], 0, nullptr);
+    vkCmdDispatch(cbuf, windSize / 8, windSize / 8, 1);
+
+    VkMemoryBarrier written{};
+    written.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    written.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    written.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &written, 0, nullptr, 0, nullptr);
+}
+
+// the command buffers are re-recorded with or without the dispatch, so wind off costs nothing on the GPU
+void appvk::setWind(bool on) {
+    windOn = on;
+    rerecordRenderCmdBuffers();
+    cout << "wind " << (on ? "on" : "off") << "\n";
+}
+
+// the field image, starting upright, and both pipelines that update it (see recordTrample)
+void appvk::createTrample() {
+    createImage(trampleSize, trampleSize, VK_FORMAT_R16G16B16A16_SFLOAT, 1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        mem::texture, trampleImage, trampleMem);
+    transitionImageLayout(trampleImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1, 1);
+
+    // everything upright. unlike the wind field this is never rewritten as a whole, so it has to start out valid
+    VkCommandBuffer cmd = beginSingleCommand();
+    const VkClearColorValue upright{};
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+    vkCmdClearColorImage(cmd, trampleImage, VK_IMAGE_LAYOUT_GENERAL, &upright, 1, &range);
+
+    VkMemoryBarrier cleared{};
+    cleared.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cleared.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    cleared.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &cleared, 0, nullptr, 0, nullptr);
+    endSingleCommand(cmd);
+
+    trampleView = createImageView(trampleImage, VK_FORMAT_R16G16B16A16_SFLOAT, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+    trampleSamp = createSampler(1);
+    tileRecovery.assign(trampleTiles * trampleTiles, 0.0f);
+    activeTiles.clear();
+    activeTiles.reserve(trampleTiles * trampleTiles); // so the render loop never allocates
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &trampleSetLayout;
+
+    VkPipelineLayout rawLayout;
+    if (vkCreatePipelineLayout(dev, &layoutInfo, nullptr, &rawLayout) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create trample layout!");
+    }
+    tramplePipeLayout = vkr::pipelineLayout(dev, rawLayout);
+    stampPipe = createComputePipeline(".spv/trample.comp.spv", tramplePipeLayout);
+    recoverPipe = createComputePipeline(".spv/recover.comp.spv", tramplePipeLayout);
+}
+
+// recorded once like the wind, both dispatches take their size from this image's trampleBufs so nothing has to be
+// re-recorded as contacts come and go. a frame with no contacts and nothing recovering dispatches zero workgroups.
+void appvk::recordTrample(VkCommandBuffer cbuf, size_t i) {
+    // the previous frame's grass may still be reading the field
+    vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    vkCmdBindDescriptorSets(cbuf, VK_PIPELINE_BIND_POINT_COMPUTE, tramplePipeLayout, 0, 1, &trampleSet[i], 0, nullptr);
+    vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_COMPUTE, recoverPipe);
+    vkCmdDispatchIndirect(cbuf, trampleBufs[i], offsetof(trampleFrame, recover));
+
+    // stamping reads what recovery just wrote, or a fresh contact would be undone by this frame's recovery
+    VkMemoryBarrier recovered{};
+    recovered.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    recovered.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    recovered.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &recovered, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cbuf, VK_PIPELINE_BIND_POINT_COMPUTE, stampPipe);
+    vkCmdDispatchIndirect(cbuf, trampleBufs[i], offsetof(trampleFrame, stamp));
+
+    VkMemoryBarrier written{};
+    written.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    written.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    written.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &written, 0, nullptr, 0, nullptr);
+}
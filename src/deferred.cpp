@@ -0,0 +1,19 @@
+#include "deferred.hpp"
+
+void vkr::deletionQueue::push(uint64_t serial, std::function<void()> fn) {
+    pending.emplace_back(serial, std::move(fn));
+}
+
+void vkr::deletionQueue::collect(uint64_t completed) {
+    while (!pending.empty() && pending.front().first <= completed) {
+        pending.front().second();
+        pending.pop_front();
+    }
+}
+
+void vkr::deletionQueue::flush() {
+    for (auto& p : pending) {
+        p.second();
+    }
+    pending.clear();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+#include "glfw_wrapper.hpp"
+
+namespace vkr {
+    // owning wrapper for a device-level handle, destroyed with destroyFn when it goes out of scope.
+    // converts to the raw handle so it can be passed straight to vulkan calls.
+    template <typename T, auto destroyFn>
+    class unique {
+    public:
+        unique() = default;
+        unique(VkDevice dev, T h) : dev(dev), h(h) {}
+
+        unique(const unique&) = delete;
+        unique& operator=(const unique&) = delete;
+
+        unique(unique&& o) noexcept : dev(o.dev), h(o.release()) {}
+        unique& operator=(unique&& o) noexcept {
+            if (this != &o) {
+                reset();
+                dev = o.dev;
+                h = o.release();
+            }
+            return *this;
+        }
+
+        ~unique() { reset(); }
+
+        operator T() const { return h; }
+        T get() const { return h; }
+        VkDevice device() const { return dev; }
+
+        T release() {
+            T t = h;
+            h = VK_NULL_HANDLE;
+            return t;
+        }
+
+        void reset() {
+            if (h != VK_NULL_HANDLE) {
+                destroyFn(dev, h, nullptr);
+                h = VK_NULL_HANDLE;
+            }
+        }
+
+    private:
+        VkDevice dev = VK_NULL_HANDLE;
+        T h = VK_NULL_HANDLE;
+    };
+
+    using pipeline = unique<VkPipeline, vkDestroyPipeline>;
+    using pipelineLayout = unique<VkPipelineLayout, vkDestroyPipelineLayout>;
+    using descriptorPool = unique<VkDescriptorPool, vkDestroyDescriptorPool>;
+    using descriptorSetLayout = unique<VkDescriptorSetLayout, vkDestroyDescriptorSetLayout>;
+    using imageView = unique<VkImageView, vkDestroyImageView>;
+    using sampler = unique<VkSampler, vkDestroySampler>;
+    using shaderModule = unique<VkShaderModule, vkDestroyShaderModule>;
+
+    // destroys resources once the GPU is done with them, instead of waiting for the device to go idle.
+    // every frame submission gets a serial; anything retired while serial N was the latest submission
+    // is destroyed once frame N is known to be complete.
+    class deletionQueue {
+    public:
+        void push(uint64_t serial, std::function<void()> fn);
+
+        template <typename T, auto destroyFn>
+        void push(uint64_t serial, unique<T, destroyFn>&& h) {
+            push(serial, [dev = h.device(), raw = h.release()] { destroyFn(dev, raw, nullptr); });
+        }
+
+        // destroy everything retired at or before the completed serial
+        void collect(uint64_t completed);
+
+        // destroy everything, only safe once the device is idle
+        void flush();
+
+        size_t size() const { return pending.size(); }
+
+    private:
+        // serials only ever increase, so this stays sorted
+        std::deque<std::pair<uint64_t, std::function<void()>>> pending;
+    };
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "dir_watch.hpp"
+
+io::dirWatcher::~dirWatcher() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool io::dirWatcher::watch(const std::string& path) {
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "cannot watch " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    // editors either write in place (close after write) or write a new file and rename it over the old one
+    if (inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "cannot watch " << path << ": " << strerror(errno) << "\n";
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    dir = path;
+    return true;
+}
+
+std::vector<std::string> io::dirWatcher::poll() {
+    std::vector<std::string> changed;
+    if (fd < 0) {
+        return changed;
+    }
+
+    alignas(inotify_event) char buf[4096];
+    while (true) {
+        const ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0) {
+            break; // EAGAIN, nothing more queued
+        }
+
+        for (ssize_t i = 0; i < len; ) {
+            const auto* ev = reinterpret_cast<const inotify_event*>(buf + i);
+            if (ev->len > 0) {
+                std::string name(ev->name);
+                if (std::find(changed.begin(), changed.end(), name) == changed.end()) {
+                    changed.push_back(std::move(name));
+                }
+            }
+            i += sizeof(inotify_event) + ev->len;
+        }
+    }
+    return changed;
+}
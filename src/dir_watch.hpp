@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace io {
+    // reports files in one directory that were written or replaced, through inotify. polling never blocks.
+    class dirWatcher {
+    public:
+        dirWatcher() = default;
+        ~dirWatcher();
+
+        dirWatcher(const dirWatcher&) = delete;
+        dirWatcher& operator=(const dirWatcher&) = delete;
+
+        // false (with the reason printed) if the directory can't be watched
+        bool watch(const std::string& dir);
+        bool watching() const { return fd >= 0; }
+
+        // names of files changed since the last poll, each reported once
+        std::vector<std::string> poll();
+
+    private:
+        int fd = -1;
+        std::string dir;
+    };
+}
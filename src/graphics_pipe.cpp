@@ -5,6 +5,10 @@
 #define STBI_NO_FAILURE_STRINGS
 #include "stb_image.h"
 
+#include <cstddef>
+
+#include <glm/gtc/packing.hpp> // packHalf1x16
+
 #include "main.hpp"
 
 // stores framebuffer config
@@ -131,11 +135,26 @@ void appvk::createRenderPass() {
 }
 
 void appvk::createGraphicsPipeline() {
-    std::vector<char> terrainvspv = readFile(".spv/terrain.vert.spv");
-    std::vector<char> terrainfspv = readFile(".spv/terrain.frag.spv");
+    VkShaderModule terrainv = loadShaderModule(".spv/terrain.vert.spv");
+    VkShaderModule terrainf = loadShaderModule(std::string(".spv/terrain.frag") + precisionSuffix(precision) + ".spv");
+
+    // the same constants go to the grass fragment shader, the terrain one just doesn't use the alpha cutoff
+    const shadingConstants shading = shadingFor(quality);
+
+    VkSpecializationMapEntry specEntries[11];
+    for (uint32_t i = 0; i < 3; i++) {
+        specEntries[i] = {i, uint32_t(offsetof(shadingConstants, lightPos) + i * sizeof(float)), sizeof(float)};
+        specEntries[i + 3] = {i + 3, uint32_t(offsetof(shadingConstants, lightColor) + i * sizeof(float)), sizeof(float)};
+        specEntries[i + 6] = {i + 6, uint32_t(offsetof(shadingConstants, falloff) + i * sizeof(float)), sizeof(float)};
+    }
+    specEntries[9] = {9, offsetof(shadingConstants, alphaCutoff), sizeof(float)};
+    specEntries[10] = {10, offsetof(shadingConstants, diffuse), sizeof(VkBool32)};
 
-    VkShaderModule terrainv = createShaderModule(terrainvspv);
-    VkShaderModule terrainf = createShaderModule(terrainfspv);
+    VkSpecializationInfo specInfo{};
+    specInfo.mapEntryCount = 11;
+    specInfo.pMapEntries = specEntries;
+    specInfo.dataSize = sizeof(shading);
+    specInfo.pData = &shading;
 
     VkPipelineShaderStageCreateInfo shaders[2] = {};
     
@@ -148,6 +167,7 @@ void appvk::createGraphicsPipeline() {
     shaders[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     shaders[1].module = terrainf;
     shaders[1].pName = "main";
+    shaders[1].pSpecializationInfo = &specInfo;
     
     VkVertexInputBindingDescription bindDesc;
     bindDesc.binding = 0;
@@ -242,18 +262,38 @@ void appvk::createGraphicsPipeline() {
     pipeLayoutCreateInfo.setLayoutCount = 1;
     pipeLayoutCreateInfo.pSetLayouts = &dSetLayout;
 
-    if (vkCreatePipelineLayout(dev, &pipeLayoutCreateInfo, nullptr, &terrainPipeLayout) != VK_SUCCESS) {
-        throw std::runtime_error("cannot create pipeline layout!");
+    VkPipelineLayout layout;
+    if (!terrainPipeLayout) {
+        if (vkCreatePipelineLayout(dev, &pipeLayoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("cannot create pipeline layout!");
+        }
+        terrainPipeLayout = vkr::pipelineLayout(dev, layout);
+    }
+
+    VkPushConstantRange fieldRange{};
+    fieldRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    fieldRange.size = sizeof(grassFieldParams);
+
+    VkPipelineLayoutCreateInfo grassLayoutCreateInfo = pipeLayoutCreateInfo;
+    grassLayoutCreateInfo.pSetLayouts = &grassSetLayout;
+    grassLayoutCreateInfo.pushConstantRangeCount = 1;
+    grassLayoutCreateInfo.pPushConstantRanges = &fieldRange;
+
+    if (!grassPipeLayout) {
+        if (vkCreatePipelineLayout(dev, &grassLayoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("cannot create grass pipeline layout!");
+        }
+        grassPipeLayout = vkr::pipelineLayout(dev, layout);
     }
 
     VkGraphicsPipelineCreateInfo pipeCreateInfo{};
     pipeCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     
+    // no derivatives, so the pipelines don't depend on each other and can compile in parallel
     if (shader_debug) {
         pipeCreateInfo.flags = VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR;
     }
     
-    pipeCreateInfo.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
     pipeCreateInfo.stageCount = 2;
     pipeCreateInfo.pStages = shaders;
     pipeCreateInfo.pVertexInputState = &vinCreateInfo;
@@ -267,26 +307,13 @@ void appvk::createGraphicsPipeline() {
     pipeCreateInfo.renderPass = renderPass;
     pipeCreateInfo.subpass = 0;
     
-    if (vkCreateGraphicsPipelines(dev, VK_NULL_HANDLE, 1, &pipeCreateInfo, nullptr, &terrainPipe) != VK_SUCCESS) {
-        throw std::runtime_error("cannot create graphics pipeline!");
-    }
-
-    if (shader_debug) {
-        printShaderStats();
-        printed = true; // prevent stats from being printed again if we recreate the pipeline
-    }
-    
-    vkDestroyShaderModule(dev, terrainv, nullptr); // we can destroy shader modules once the graphics pipeline is created.
-    vkDestroyShaderModule(dev, terrainf, nullptr);
-
     VkGraphicsPipelineCreateInfo grassPipeCreateInfo = pipeCreateInfo;
 
     // creating grass pipeline from same struct since almost everything is the same
-    std::vector<char> grassvspv = readFile(".spv/grass.vert.spv");
-    std::vector<char> grassfspv = readFile(".spv/grass.frag.spv");
-
-    VkShaderModule grassv = createShaderModule(grassvspv);
-    VkShaderModule grassf = createShaderModule(grassfspv);
+    const bool field = settings.grassMode == options::grass::field;
+    const bool clump = settings.grassClump > 1;
+    VkShaderModule grassv = loadShaderModule(field ? ".spv/grassfield.vert.spv" : clump ? ".spv/grassclump.vert.spv" : ".spv/grass.vert.spv");
+    VkShaderModule grassf = loadShaderModule(std::string(".spv/grass.frag") + precisionSuffix(precision) + ".spv");
 
     VkPipelineShaderStageCreateInfo grassShaders[2] = {};
 
@@ -299,34 +326,47 @@ void appvk::createGraphicsPipeline() {
     grassShaders[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     grassShaders[1].module = grassf;
     grassShaders[1].pName = "main";
+    grassShaders[1].pSpecializationInfo = &specInfo;
 
     VkVertexInputBindingDescription bindDesc2[2];
     bindDesc2[0] = bindDesc;
 
     bindDesc2[1].binding = 1;
-    bindDesc2[1].stride = sizeof(glm::mat4);
+    bindDesc2[1].stride = sizeof(glm::vec4); // position and yaw, see scatterGrass()
     bindDesc2[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
-    VkVertexInputAttributeDescription attrDesc2[7];
+    VkVertexInputAttributeDescription attrDesc2[4];
     for (size_t i = 0; i < 3; i++) {
         attrDesc2[i] = attrDesc[i];
     }
 
-    // mat4 requires four slots in vertex shader
-    for (size_t i = 3; i < 7; i++) {
-        attrDesc2[i].binding = 1;
-        attrDesc2[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        attrDesc2[i].location = i;
-        attrDesc2[i].offset = sizeof(glm::vec4) * (i - 3); // NOTE: vertex inputs _have_ to be distinct even if they come from different binding points.
-    }
+    // NOTE: vertex inputs _have_ to be distinct even if they come from different binding points.
+    attrDesc2[3].binding = 1;
+    attrDesc2[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attrDesc2[3].location = 3;
+    attrDesc2[3].offset = 0;
 
     VkPipelineVertexInputStateCreateInfo vinCreateInfo2{};
     vinCreateInfo2.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vinCreateInfo2.vertexBindingDescriptionCount = 2;
     vinCreateInfo2.pVertexBindingDescriptions = bindDesc2;
-    vinCreateInfo2.vertexAttributeDescriptionCount = 7;
+    vinCreateInfo2.vertexAttributeDescriptionCount = 4;
     vinCreateInfo2.pVertexAttributeDescriptions = attrDesc2;
 
+    // clumps make up their vertices, the instance is the only input
+    VkVertexInputBindingDescription clumpBindDesc = bindDesc2[1];
+    clumpBindDesc.binding = 0;
+
+    VkVertexInputAttributeDescription clumpAttrDesc = attrDesc2[3];
+    clumpAttrDesc.binding = 0;
+    clumpAttrDesc.location = 0;
+
+    VkPipelineVertexInputStateCreateInfo clumpVinCreateInfo = vinCreateInfo2;
+    clumpVinCreateInfo.vertexBindingDescriptionCount = 1;
+    clumpVinCreateInfo.pVertexBindingDescriptions = &clumpBindDesc;
+    clumpVinCreateInfo.vertexAttributeDescriptionCount = 1;
+    clumpVinCreateInfo.pVertexAttributeDescriptions = &clumpAttrDesc;
+
     VkPipelineColorBlendAttachmentState colorAttachment2{};
     colorAttachment2.blendEnable = VK_TRUE;
     colorAttachment2.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
@@ -363,31 +403,33 @@ void appvk::createGraphicsPipeline() {
     dCreateInfo2.depthBoundsTestEnable = VK_FALSE;
     dCreateInfo2.stencilTestEnable = VK_FALSE;
 
-    grassPipeCreateInfo.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
-    grassPipeCreateInfo.basePipelineHandle = terrainPipe;
-    grassPipeCreateInfo.basePipelineIndex = -1;
     grassPipeCreateInfo.pStages = grassShaders;
-    grassPipeCreateInfo.pVertexInputState = &vinCreateInfo2;
+    grassPipeCreateInfo.pVertexInputState = field ? &vinCreateInfo : clump ? &clumpVinCreateInfo : &vinCreateInfo2; // field grass has no instance attribute
     grassPipeCreateInfo.pRasterizationState = &rasterCreateInfo2;
     grassPipeCreateInfo.pColorBlendState = &colorCreateInfo2;
     grassPipeCreateInfo.pDepthStencilState = &dCreateInfo2;
-    grassPipeCreateInfo.layout = terrainPipeLayout;
+    grassPipeCreateInfo.layout = grassPipeLayout;
     // render pass is the same
     grassPipeCreateInfo.subpass = 1;
-    
-    if (vkCreateGraphicsPipelines(dev, VK_NULL_HANDLE, 1, &grassPipeCreateInfo, nullptr, &grassPipe) != VK_SUCCESS) {
-        throw std::runtime_error("cannot create graphics pipeline!");
-    }
 
-    vkDestroyShaderModule(dev, grassv, nullptr);
-    vkDestroyShaderModule(dev, grassf, nullptr);
+    // impostor cards go in the grass subpass with the same state, they make up their vertices like clumps do
+    VkPipelineVertexInputStateCreateInfo cardVinCreateInfo{};
+    cardVinCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineShaderStageCreateInfo impostorShaders[2] = { grassShaders[0], grassShaders[1] };
+    VkGraphicsPipelineCreateInfo impostorPipeCreateInfo = grassPipeCreateInfo;
+    const VkSpecializationInfo atlasSpec = impostorSpecInfo();
+    if (impostors) {
+        impostorShaders[0].module = loadShaderModule(".spv/impostor.vert.spv");
+        impostorShaders[0].pSpecializationInfo = &atlasSpec;
+        impostorShaders[1].module = loadShaderModule(std::string(".spv/impostor.frag") + precisionSuffix(precision) + ".spv");
+        impostorPipeCreateInfo.pStages = impostorShaders;
+        impostorPipeCreateInfo.pVertexInputState = &cardVinCreateInfo;
+    }
 
     // creating grass pipeline from same struct since almost everything is the same
-    std::vector<char> skyvspv = readFile(".spv/skybox.vert.spv");
-    std::vector<char> skyfspv = readFile(".spv/skybox.frag.spv");
-
-    VkShaderModule skyv = createShaderModule(skyvspv);
-    VkShaderModule skyf = createShaderModule(skyfspv);
+    VkShaderModule skyv = loadShaderModule(".spv/skybox.vert.spv");
+    VkShaderModule skyf = loadShaderModule(".spv/skybox.frag.spv");
 
     VkPipelineShaderStageCreateInfo skyShaders[2] = {};
 
@@ -437,25 +479,141 @@ void appvk::createGraphicsPipeline() {
     skyLayoutCreateInfo.setLayoutCount = 1;
     skyLayoutCreateInfo.pSetLayouts = &skySetLayout;
 
-    if (vkCreatePipelineLayout(dev, &skyLayoutCreateInfo, nullptr, &skyPipeLayout) != VK_SUCCESS) {
-        throw std::runtime_error("cannot create skybox layout!");
+    if (!skyPipeLayout) {
+        if (vkCreatePipelineLayout(dev, &skyLayoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("cannot create skybox layout!");
+        }
+        skyPipeLayout = vkr::pipelineLayout(dev, layout);
     }
 
     skyPipeCreateInfo.pVertexInputState = &skyVertCreateInfo;
     skyPipeCreateInfo.pRasterizationState = &skyRasterCreateInfo;
     skyPipeCreateInfo.layout = skyPipeLayout;
-
-    skyPipeCreateInfo.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
-    skyPipeCreateInfo.basePipelineHandle = terrainPipe;
-    skyPipeCreateInfo.basePipelineIndex = -1;
     skyPipeCreateInfo.subpass = 2;
 
-    if (vkCreateGraphicsPipelines(dev, VK_NULL_HANDLE, 1, &skyPipeCreateInfo, nullptr, &skyPipe) != VK_SUCCESS) {
-        throw std::runtime_error("cannot create skybox pipeline!");
+    // only compile what this swapchain doesn't have yet
+    std::vector<VkGraphicsPipelineCreateInfo> infos;
+    std::vector<vkr::pipeline*> out;
+    if (!skyPipe) {
+        infos.push_back(skyPipeCreateInfo);
+        out.push_back(&skyPipe);
     }
 
-    vkDestroyShaderModule(dev, skyv, nullptr);
-    vkDestroyShaderModule(dev, skyf, nullptr);
+    // a variant that exists can still be missing pipelines that a shader reload threw away
+    struct {
+        shadingConstants shading;
+        fragPrecision precision;
+    } key{shading, precision};
+    static_assert(sizeof(key) == sizeof(shading) + sizeof(precision), "variant keys are hashed, so they can't have padding");
+    const uint64_t variantKey = vkr::shaderRegistry::hash(&key, sizeof(key));
+    auto [variant, added] = shadedVariants.try_emplace(variantKey);
+    if (!variant->second.terrain) {
+        infos.push_back(pipeCreateInfo);
+        out.push_back(&variant->second.terrain);
+    }
+    if (!variant->second.grass) {
+        infos.push_back(grassPipeCreateInfo);
+        out.push_back(&variant->second.grass);
+    }
+    if (impostors && !variant->second.impostor) {
+        infos.push_back(impostorPipeCreateInfo);
+        out.push_back(&variant->second.impostor);
+    }
+
+    try {
+        createPipelines(infos, out);
+    } catch (...) {
+        if (added) {
+            shadedVariants.erase(variantKey);
+        }
+        throw;
+    }
+
+    terrainPipe = variant->second.terrain;
+    grassPipe = variant->second.grass;
+    impostorPipe = variant->second.impostor;
+
+    if (shader_debug) {
+        printShaderStats();
+        printed = true; // prevent stats from being printed again if we recreate the pipeline
+    }
+}
+
+appvk::shadingConstants appvk::shadingFor(options::quality q) {
+    shadingConstants c{};
+    c.lightPos = glm::vec3(0.0f, 10.0f, -12.0f);
+    c.lightColor = glm::vec3(0.5f);
+    c.falloff = glm::vec3(1.0f, 0.0f, 0.0f);
+    c.alphaCutoff = 0.9f;
+    c.diffuse = q == options::quality::high ? VK_TRUE : VK_FALSE;
+    return c;
+}
+
+const char* appvk::precisionSuffix(fragPrecision p) {
+    switch (p) {
+        case fragPrecision::half: return ".f16";
+        case fragPrecision::relaxed: return ".relaxed";
+        default: return "";
+    }
+}
+
+const char* appvk::precisionName(fragPrecision p) {
+    switch (p) {
+        case fragPrecision::half: return "fp16";
+        case fragPrecision::relaxed: return "relaxed precision";
+        default: return "fp32";
+    }
+}
+
+// the render command buffers bind pipelines directly, so they get re-recorded with the new tier's
+void appvk::setQuality(options::quality q) {
+    quality = q;
+    createGraphicsPipeline(); // a no-op if this tier was already used since the last swapchain recreation
+    rerecordRenderCmdBuffers();
+    cout << options::qualityName(q) << " quality shading\n";
+}
+
+// also after a shader reload, pipelines are baked into the recorded commands
+void appvk::rerecordRenderCmdBuffers() {
+    waitForFrame(submittedSerial); // nothing may still be executing the old command buffers
+    vkFreeCommandBuffers(dev, cp, commandBuffers.size(), commandBuffers.data());
+    gpuTimes.destroy();
+    allocRenderCmdBuffers();
+
+    drawnView = viewState{}; // on-demand rendering has to draw the change
+}
+
+void appvk::createPipelineCache() {
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (vkCreatePipelineCache(dev, &createInfo, nullptr, &pipeCache) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create pipeline cache!");
+    }
+}
+
+// compile every pipeline on the worker threads at once, returns when they are all done.
+// pipeline caches are internally synchronized, so every compile shares pipeCache.
+void appvk::createPipelines(const std::vector<VkGraphicsPipelineCreateInfo>& infos, const std::vector<vkr::pipeline*>& out) {
+    std::vector<VkPipeline> pipes(infos.size(), VK_NULL_HANDLE);
+    std::vector<VkResult> results(infos.size(), VK_SUCCESS);
+
+    workers.parallelFor(infos.size(), [&](size_t i) {
+        results[i] = vkCreateGraphicsPipelines(dev, pipeCache, 1, &infos[i], nullptr, &pipes[i]);
+    });
+
+    // take ownership of everything that did compile first, so a failure doesn't leak the rest
+    bool failed = false;
+    for (size_t i = 0; i < infos.size(); i++) {
+        if (results[i] == VK_SUCCESS) {
+            *out[i] = vkr::pipeline(dev, pipes[i]);
+        } else {
+            failed = true;
+        }
+    }
+    if (failed) {
+        throw std::runtime_error("cannot create graphics pipeline!");
+    }
 }
 
 void appvk::createFramebuffers() {
@@ -486,86 +644,96 @@ void appvk::createFramebuffers() {
     }
 }
 
-std::pair<VkBuffer, VkDeviceMemory> appvk::createVertexBuffer(const std::vector<uint8_t>& verts) {
-    VkBuffer vertexBuf;
-    VkDeviceMemory vertexMem;
+// create a device-local buffer holding size bytes of data.
+// on UMA and resizable BAR devices the host writes straight into it, otherwise the data goes through a staging buffer.
+std::pair<VkBuffer, VkDeviceMemory> appvk::createUploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, mem::category cat) {
+    VkBuffer buf;
+    VkDeviceMemory bufMem;
 
-    VkBuffer stagingBuf;
-    VkDeviceMemory stagingMem;
+    VkBufferCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    createInfo.size = size;
+    createInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT; // in case we have to fall back to a copy
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    VkDeviceSize bufferSize = verts.size();
-    createBuffer(verts.size(), 
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-        stagingBuf, stagingMem);
-    
-    createBuffer(verts.size(), 
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-        vertexBuf, vertexMem);
-
-    void *data;
-    vkMapMemory(dev, stagingMem, 0, bufferSize, 0, &data);
-    memcpy(data, verts.data(), bufferSize);
-    vkUnmapMemory(dev, stagingMem);
+    if (vkCreateBuffer(dev, &createInfo, nullptr, &buf) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create buffer!");
+    }
 
-    copyBuffer(stagingBuf, vertexBuf, bufferSize);
+    VkMemoryRequirements mreq{};
+    vkGetBufferMemoryRequirements(dev, buf, &mreq);
 
-    vkFreeMemory(dev, stagingMem, nullptr);
-    vkDestroyBuffer(dev, stagingBuf, nullptr);
+    std::optional<uint32_t> directType;
+    if (directUpload) {
+        directType = pickMemoryType(mreq.memoryTypeBits, directMemory, 0, 0, mreq.size);
+    }
 
-    return std::pair(vertexBuf, vertexMem);
-}
+    if (directType) {
+        allocateMemory(mreq, *directType, cat, bufMem);
+        vkBindBufferMemory(dev, buf, bufMem, 0);
 
-// wrapper for raw createVertexBuffer that takes a vloader mesh
-std::pair<VkBuffer, VkDeviceMemory> appvk::createVertexBuffer(std::vector<vformat::vertex>& v) {
-    auto bytePtr = reinterpret_cast<uint8_t*>(v.data());
-	std::vector<uint8_t> byteData(bytePtr, bytePtr + v.size() * sizeof(vformat::vertex));
+        void *map;
+        vkMapMemory(dev, bufMem, 0, size, 0, &map);
+        memcpy(map, data, size);
+        vkUnmapMemory(dev, bufMem);
 
-    return createVertexBuffer(byteData);
-}
+        // the next queue submission makes coherent host writes visible, no barrier needed
+        return std::pair(buf, bufMem);
+    }
 
+    const mem::preference pref = mem::categoryPreference(cat);
+    allocateMemory(mreq, findMemoryType(mreq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pref.preferred, pref.avoided, mreq.size), cat, bufMem);
+    vkBindBufferMemory(dev, buf, bufMem, 0);
 
-std::pair<VkBuffer, VkDeviceMemory> appvk::createIndexBuffer(const std::vector<uint32_t>& indices) {
-    VkBuffer indexBuf;
-    VkDeviceMemory indexMem;
-    
     VkBuffer stagingBuf;
     VkDeviceMemory stagingMem;
-    
-    VkDeviceSize bufferSize = indices.size() * sizeof(uint32_t);
 
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    stagingBuf, stagingMem);
-
-    createBuffer(bufferSize,
-    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    indexBuf, indexMem);
+    createBuffer(size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        mem::staging, stagingBuf, stagingMem);
 
-    void *data;
-    vkMapMemory(dev, stagingMem, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), bufferSize);
+    void *map;
+    vkMapMemory(dev, stagingMem, 0, size, 0, &map);
+    memcpy(map, data, size);
     vkUnmapMemory(dev, stagingMem);
 
-    copyBuffer(stagingBuf, indexBuf, bufferSize);
+    copyBuffer(stagingBuf, buf, size);
 
-    vkFreeMemory(dev, stagingMem, nullptr);
-    vkDestroyBuffer(dev, stagingBuf, nullptr);
+    releaseStaging(stagingBuf, stagingMem);
 
-    return std::pair(indexBuf, indexMem);
+    return std::pair(buf, bufMem);
 }
 
-std::tuple<VkImage, VkDeviceMemory, unsigned int> appvk::createTextureImage(std::string_view path, bool flip) {
+std::pair<VkBuffer, VkDeviceMemory> appvk::createVertexBuffer(const void* verts, VkDeviceSize size, mem::category cat) {
+    return createUploadBuffer(verts, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, cat);
+}
+
+// wrapper for raw createVertexBuffer that takes a vloader mesh
+std::pair<VkBuffer, VkDeviceMemory> appvk::createVertexBuffer(const std::vector<vformat::vertex>& v) {
+    return createVertexBuffer(v.data(), v.size() * sizeof(vformat::vertex), mem::vertex);
+}
+
+// reads and decodes an image file, safe to call from any thread
+appvk::decodedImage appvk::decodeImage(std::string_view path, bool flip) {
     // if the image format considers the origin to be the top left (png), then flip.
-    stbi_set_flip_vertically_on_load_thread(flip);
+    stbi_set_flip_vertically_on_load_thread(flip); // per thread
+
+    // decode straight out of the mapping instead of letting stb_image read the file through stdio
+    io::mappedFile file{std::string(path)};
 
-    int width, height, chans;
-    unsigned char *data = stbi_load(path.data(), &width, &height, &chans, STBI_rgb_alpha);
-    if (!data) {
+    decodedImage img;
+    int chans;
+    img.pixels = decodedImage::pixelPtr(stbi_load_from_memory(file.data(), file.size(), &img.width, &img.height, &chans, STBI_rgb_alpha), stbi_image_free);
+    if (!img.pixels) {
         throw std::runtime_error("cannot load texture!");
     }
+    return img;
+}
+
+// format is VK_FORMAT_R8G8B8A8_SRGB for colors, or _UNORM for data like masks
+std::tuple<VkImage, VkDeviceMemory, unsigned int> appvk::createTextureImage(const decodedImage& img, VkFormat format) {
+    const int width = img.width, height = img.height;
 
     unsigned int mipLevels = floor(log2(std::max(width, height))) + 1;
     
@@ -577,86 +745,158 @@ std::tuple<VkImage, VkDeviceMemory, unsigned int> appvk::createTextureImage(std:
     createBuffer(imageSize, 
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        sbuf, smem);
+        mem::staging, sbuf, smem);
 
     void *map_data;
     vkMapMemory(dev, smem, 0, imageSize, 0, &map_data);
-    memcpy(map_data, data, imageSize);
+    memcpy(map_data, img.pixels.get(), imageSize);
     vkUnmapMemory(dev, smem);
 
-    stbi_image_free(data);
-
     VkImage texImage;
     VkDeviceMemory texMem;
 
     // used as a src when blitting to make mipmaps
-    createImage(width, height, VK_FORMAT_R8G8B8A8_SRGB, mipLevels, VK_SAMPLE_COUNT_1_BIT,
+    createImage(width, height, format, mipLevels, VK_SAMPLE_COUNT_1_BIT,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        texImage, texMem);
+        mem::texture, texImage, texMem);
     
     transitionImageLayout(texImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, 1);
     copyBufferToImage(sbuf, texImage, uint32_t(width), uint32_t(height), 1);
 
-    vkFreeMemory(dev, smem, nullptr);
-    vkDestroyBuffer(dev, sbuf, nullptr);
+    releaseStaging(sbuf, smem);
 
-    generateMipmaps(texImage, VK_FORMAT_R8G8B8A8_SRGB, width, height, mipLevels, 1);
+    generateMipmaps(texImage, format, width, height, mipLevels, 1);
 
     return std::tuple(texImage, texMem, mipLevels);
 }
 
-std::tuple<VkImage, VkDeviceMemory> appvk::createCubemapImage(std::array<std::string_view, 6> paths, bool flip) {
-    // if the image format considers the origin to be the top left (png), then flip.
-    stbi_set_flip_vertically_on_load_thread(flip);
+// ground height at the center of each texel, linear filtering between centers is close enough to the
+// terrain's own interpolation for placing grass. runs on a worker once the terrain is generated.
+std::vector<uint16_t> appvk::sampleHeightmap() {
+    std::vector<uint16_t> heights(heightmapSize * heightmapSize);
+    const glm::vec2 texel = terrainSize / float(heightmapSize);
+    for (uint32_t z = 0; z < heightmapSize; z++) {
+        for (uint32_t x = 0; x < heightmapSize; x++) {
+            const glm::vec2 p = terrainOrigin + (glm::vec2(x, z) + 0.5f) * texel;
+            heights[z * heightmapSize + x] = glm::packHalf1x16(t.getHeight(p.x, p.y));
+        }
+    }
+    return heights;
+}
 
-    unsigned char* imgs[6];
+// one level of R16_SFLOAT, which every device can filter linearly. no mips, the vertex shader always reads level 0.
+std::tuple<VkImage, VkDeviceMemory> appvk::createHeightmapImage(const std::vector<uint16_t>& heights) {
+    VkDeviceSize imageSize = heights.size() * sizeof(uint16_t);
 
-    int width, height, chans;
-    for (size_t i = 0; i < 6; i++) {
-        imgs[i] = stbi_load(paths[i].data(), &width, &height, &chans, STBI_rgb_alpha);
-        if (!imgs[i]) {
-            throw std::runtime_error("cannot load texture!");
+    VkBuffer sbuf = VK_NULL_HANDLE;
+    VkDeviceMemory smem = VK_NULL_HANDLE;
+
+    createBuffer(imageSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        mem::staging, sbuf, smem);
+
+    void *map_data;
+    vkMapMemory(dev, smem, 0, imageSize, 0, &map_data);
+    memcpy(map_data, heights.data(), imageSize);
+    vkUnmapMemory(dev, smem);
+
+    VkImage image;
+    VkDeviceMemory imageMem;
+
+    createImage(heightmapSize, heightmapSize, VK_FORMAT_R16_SFLOAT, 1, VK_SAMPLE_COUNT_1_BIT,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        mem::texture, image, imageMem);
+
+    transitionImageLayout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, 1);
+    copyBufferToImage(sbuf, image, heightmapSize, heightmapSize, 1);
+    transitionImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1, 1);
+
+    releaseStaging(sbuf, smem);
+
+    return std::tuple(image, imageMem);
+}
+
+std::tuple<VkImage, VkDeviceMemory> appvk::createCubemapImage(const std::array<decodedImage, 6>& faces) {
+    for (const auto& f : faces) {
+        if (f.width != faces[0].width || f.height != faces[0].height) {
+            throw std::runtime_error("cubemap faces differ in size!");
         }
     }
+
+    const int width = faces[0].width, height = faces[0].height;
     
     VkDeviceSize imageSize = width * height * 4;
     VkDeviceSize cubeSize = imageSize * 6;
 
+    VkImage texImage;
+    VkDeviceMemory texMem;
+
+    // the cubemap has no mips, so on UMA devices it can be a linear image the host writes directly.
+    // (linear images sample slower from dedicated VRAM, so this is not worth it for resizable BAR)
+    if (directUpload && uma && linearImageSupported(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, 6)) {
+        createCubeImage(width, height, VK_FORMAT_R8G8B8A8_SRGB, VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_TILING_LINEAR,
+            VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            mem::texture, texImage, texMem);
+
+        uint8_t* map_data;
+        vkMapMemory(dev, texMem, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&map_data));
+
+        for (uint32_t i = 0; i < 6; i++) {
+            // rows of linear images can be padded, so copy row by row
+            VkImageSubresource face{};
+            face.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            face.arrayLayer = i;
+
+            VkSubresourceLayout layout;
+            vkGetImageSubresourceLayout(dev, texImage, &face, &layout);
+
+            for (int row = 0; row < height; row++) {
+                memcpy(map_data + layout.offset + row * layout.rowPitch, faces[i].pixels.get() + row * width * 4, width * 4);
+            }
+        }
+
+        vkUnmapMemory(dev, texMem);
+
+        transitionImageLayout(texImage, VK_IMAGE_LAYOUT_PREINITIALIZED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1, 6);
+
+        return std::tuple(texImage, texMem);
+    }
+
     VkBuffer sbuf = VK_NULL_HANDLE;
     VkDeviceMemory smem = VK_NULL_HANDLE;
 
     createBuffer(cubeSize, 
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        sbuf, smem);
+        mem::staging, sbuf, smem);
 
     for (size_t i = 0; i < 6; i++) {
         void *map_data;
         vkMapMemory(dev, smem, i * imageSize, imageSize, 0, &map_data);
-        memcpy(map_data, imgs[i], imageSize);
+        memcpy(map_data, faces[i].pixels.get(), imageSize);
         vkUnmapMemory(dev, smem);
-        stbi_image_free(imgs[i]);
     }
 
-    VkImage texImage;
-    VkDeviceMemory texMem;
-
     // used as a src when blitting to make mipmaps
     createCubeImage(width, height, VK_FORMAT_R8G8B8A8_SRGB, VK_SAMPLE_COUNT_1_BIT,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        texImage, texMem);
+        mem::texture, texImage, texMem);
     
     transitionImageLayout(texImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, 6);
     copyBufferToImage(sbuf, texImage, uint32_t(width), uint32_t(height), 6);
 
-    vkFreeMemory(dev, smem, nullptr);
-    vkDestroyBuffer(dev, sbuf, nullptr);
+    releaseStaging(sbuf, smem);
 
     // no mip levels generated, but this puts all cube images in the shader read optimal layout
     generateMipmaps(texImage, VK_FORMAT_R8G8B8A8_SRGB, width, height, 1, 6);
@@ -664,13 +904,59 @@ std::tuple<VkImage, VkDeviceMemory> appvk::createCubemapImage(std::array<std::st
     return std::tuple(texImage, texMem);
 }
 
+// baked image with every mip level already in it, so this is one copy and no blits
+std::tuple<VkImage, VkDeviceMemory, unsigned int> appvk::createPackedImage(const pack::entry& e) {
+    const bool cube = e.layers() == 6;
+    if (cube ? e.mipLevels() != 1 : e.layers() != 1) {
+        throw std::runtime_error("unsupported packed image!");
+    }
+
+    VkBuffer sbuf = VK_NULL_HANDLE;
+    VkDeviceMemory smem = VK_NULL_HANDLE;
+
+    createBuffer(e.size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        mem::staging, sbuf, smem);
+
+    void *map_data;
+    vkMapMemory(dev, smem, 0, e.size, 0, &map_data);
+    memcpy(map_data, assetPack.data(e), e.size);
+    vkUnmapMemory(dev, smem);
+
+    VkImage texImage;
+    VkDeviceMemory texMem;
+
+    if (cube) {
+        createCubeImage(e.width(), e.height(), VK_FORMAT_R8G8B8A8_SRGB, VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            mem::texture, texImage, texMem);
+    } else {
+        createImage(e.width(), e.height(), VK_FORMAT_R8G8B8A8_SRGB, e.mipLevels(), VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            mem::texture, texImage, texMem);
+    }
+
+    transitionImageLayout(texImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, e.mipLevels(), e.layers());
+    copyMipsToImage(sbuf, texImage, e);
+    transitionImageLayout(texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, e.mipLevels(), e.layers());
+
+    releaseStaging(sbuf, smem);
+
+    return std::tuple(texImage, texMem, e.mipLevels());
+}
+
 void appvk::createDepthImage() {
     createImage(swapExtent.width, swapExtent.height,
         depthFormat, 1, msaaSamples,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        depthImage, depthMemory);
+        mem::attachment, depthImage, depthMemory);
     
     transitionImageLayout(depthImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1, 1);
     
@@ -682,7 +968,7 @@ void appvk::createMultisampleImage() {
     VK_IMAGE_TILING_OPTIMAL,
     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    msImage, msMemory);
+    mem::attachment, msImage, msMemory);
 
     msImageView = createImageView(msImage, swapFormat, 1, VK_IMAGE_ASPECT_COLOR_BIT);
 }
\ No newline at end of file
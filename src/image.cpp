@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "main.hpp"
 
 VkImageView appvk::createImageView(VkImage im, VkFormat format, unsigned int mipLevels, VkImageAspectFlags aspectMask) {
@@ -76,6 +78,24 @@ VkFormat appvk::findImageFormat(const std::vector<VkFormat>& formats, VkImageTil
     return VK_FORMAT_UNDEFINED;
 }
 
+// check if a linear-tiled image with a single mip level can be sampled from
+bool appvk::linearImageSupported(VkFormat format, VkImageUsageFlags usage, VkImageCreateFlags flags, unsigned int layers) {
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(pdev, format, &formatProps);
+
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((formatProps.linearTilingFeatures & features) != features) {
+        return false;
+    }
+
+    VkImageFormatProperties imageProps;
+    if (vkGetPhysicalDeviceImageFormatProperties(pdev, format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_LINEAR, usage, flags, &imageProps) != VK_SUCCESS) {
+        return false;
+    }
+
+    return imageProps.maxArrayLayers >= layers;
+}
+
 // transition miplevels of image from the oldl layout to the newl layout
 void appvk::transitionImageLayout(VkImage image, VkImageLayout oldl, VkImageLayout newl, unsigned int mipLevels, unsigned int layers) {
     VkCommandBuffer buf = beginSingleCommand();
@@ -114,10 +134,24 @@ void appvk::transitionImageLayout(VkImage image, VkImageLayout oldl, VkImageLayo
         barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     } else if (oldl == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newl == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
         srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dstStage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT; // the grass heightmap is read by a vertex shader
 
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    } else if (oldl == VK_IMAGE_LAYOUT_PREINITIALIZED && newl == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        // texels written by the host through a mapping, no copy involved
+        srcStage = VK_PIPELINE_STAGE_HOST_BIT;
+        dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+        barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    } else if (oldl == VK_IMAGE_LAYOUT_UNDEFINED && newl == VK_IMAGE_LAYOUT_GENERAL) {
+        // storage images written by compute shaders, they stay in this layout
+        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
     } else if (oldl == VK_IMAGE_LAYOUT_UNDEFINED && newl == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
         srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
         dstStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
@@ -153,7 +187,31 @@ void appvk::copyBufferToImage(VkBuffer buf, VkImage img, uint32_t width, uint32_
     endSingleCommand(cbuf);
 }
 
-void appvk::createImage(unsigned int width, unsigned int height, VkFormat format, unsigned int mipLevels, VkSampleCountFlagBits samples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, VkImage& image, VkDeviceMemory& imageMemory) {
+// one region per mip level, each covering every layer, in the order the baker wrote them
+void appvk::copyMipsToImage(VkBuffer buf, VkImage img, const pack::entry& e) {
+    VkCommandBuffer cbuf = beginSingleCommand();
+
+    std::vector<VkBufferImageCopy> copies(e.mipLevels());
+    VkDeviceSize offset = 0;
+    for (uint32_t l = 0; l < e.mipLevels(); l++) {
+        VkBufferImageCopy& copy = copies[l];
+        copy.bufferOffset = offset;
+        copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.imageSubresource.mipLevel = l;
+        copy.imageSubresource.baseArrayLayer = 0;
+        copy.imageSubresource.layerCount = e.layers();
+        copy.imageOffset = {0, 0, 0};
+        copy.imageExtent = {std::max(e.width() >> l, 1u), std::max(e.height() >> l, 1u), 1};
+
+        offset += pack::mipSize(e, l) * e.layers();
+    }
+
+    vkCmdCopyBufferToImage(cbuf, buf, img, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copies.size(), copies.data());
+
+    endSingleCommand(cbuf);
+}
+
+void appvk::createImage(unsigned int width, unsigned int height, VkFormat format, unsigned int mipLevels, VkSampleCountFlagBits samples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, mem::category cat, VkImage& image, VkDeviceMemory& imageMemory) {
     VkImageCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     createInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -165,8 +223,9 @@ void appvk::createImage(unsigned int width, unsigned int height, VkFormat format
     createInfo.tiling = tiling;
     createInfo.usage = usage;
     createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // discard existing texels when loading
-    // initiallayout can only be ..._UNDEFINED or ..._PREINITIALIZED
+    // initiallayout can only be ..._UNDEFINED or ..._PREINITIALIZED.
+    // linear images are only used when the host writes texels directly, so keep those.
+    createInfo.initialLayout = tiling == VK_IMAGE_TILING_LINEAR ? VK_IMAGE_LAYOUT_PREINITIALIZED : VK_IMAGE_LAYOUT_UNDEFINED;
     if (vkCreateImage(dev, &createInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("cannot create texture image!");
     }
@@ -174,19 +233,12 @@ void appvk::createImage(unsigned int width, unsigned int height, VkFormat format
     VkMemoryRequirements memReq;
     vkGetImageMemoryRequirements(dev, image, &memReq);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memReq.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, props);
-
-    if (vkAllocateMemory(dev, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("cannot allocate texture memory!");
-    }
+    allocateMemory(memReq, props, cat, imageMemory);
 
     vkBindImageMemory(dev, image, imageMemory, 0);
 }
 
-void appvk::createCubeImage(unsigned int width, unsigned int height, VkFormat format, VkSampleCountFlagBits samples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, VkImage& image, VkDeviceMemory& imageMemory) {
+void appvk::createCubeImage(unsigned int width, unsigned int height, VkFormat format, VkSampleCountFlagBits samples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, mem::category cat, VkImage& image, VkDeviceMemory& imageMemory) {
     VkImageCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     createInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT; // needed to create image views of cube type
@@ -199,8 +251,9 @@ void appvk::createCubeImage(unsigned int width, unsigned int height, VkFormat fo
     createInfo.tiling = tiling;
     createInfo.usage = usage;
     createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // discard existing texels when loading
-    // initiallayout can only be ..._UNDEFINED or ..._PREINITIALIZED
+    // initiallayout can only be ..._UNDEFINED or ..._PREINITIALIZED.
+    // linear images are only used when the host writes texels directly, so keep those.
+    createInfo.initialLayout = tiling == VK_IMAGE_TILING_LINEAR ? VK_IMAGE_LAYOUT_PREINITIALIZED : VK_IMAGE_LAYOUT_UNDEFINED;
     if (vkCreateImage(dev, &createInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("cannot create texture image!");
     }
@@ -208,14 +261,7 @@ void appvk::createCubeImage(unsigned int width, unsigned int height, VkFormat fo
     VkMemoryRequirements memReq;
     vkGetImageMemoryRequirements(dev, image, &memReq);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memReq.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, props);
-
-    if (vkAllocateMemory(dev, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("cannot allocate texture memory!");
-    }
+    allocateMemory(memReq, props, cat, imageMemory);
 
     vkBindImageMemory(dev, image, imageMemory, 0);
 }
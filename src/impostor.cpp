@@ -0,0 +1,462 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include "main.hpp"
+
+namespace {
+    // levels 1 and below of the normal and coverage atlas, box filtered from the full size rgba8 texels in base,
+    // one level after the other. coverage is rescaled per view and level so as many texels pass impostor.frag's
+    // alpha test as at the full size, averaged alone it thins out until far cards vanish. the filtered coverage
+    // itself stays in the color image's alpha. views never share a 2x2 box since tile is a power of two.
+    std::vector<uint8_t> coverageMips(const uint8_t* base, uint32_t width, uint32_t height, uint32_t tile, uint32_t levels) {
+        const uint32_t tilesX = width / tile, tilesY = height / tile;
+
+        std::vector<float> target(tilesX * tilesY, 0.0f);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                target[(y / tile) * tilesX + x / tile] += base[(y * width + x) * 4 + 3] > 127;
+            }
+        }
+        for (float& t : target) {
+            t /= float(tile * tile);
+        }
+
+        // what is stored is what is tested, rounded the same way
+        auto alpha = [](float a, float scale) {
+            return uint8_t(std::min(a * scale, 255.0f) + 0.5f);
+        };
+
+        std::vector<float> prev(base, base + size_t(width) * height * 4);
+        std::vector<uint8_t> out;
+        for (uint32_t l = 1; l < levels; l++) {
+            const uint32_t w = width >> l, h = height >> l, t = tile >> l;
+            std::vector<float> cur(size_t(w) * h * 4);
+            for (uint32_t y = 0; y < h; y++) {
+                const float* row0 = &prev[size_t(2 * y) * (2 * w) * 4];
+                const float* row1 = row0 + size_t(2 * w) * 4;
+                for (uint32_t x = 0; x < w * 4; x++) {
+                    const uint32_t i = (x / 4) * 8 + x % 4;
+                    cur[size_t(y) * w * 4 + x] = 0.25f * (row0[i] + row0[i + 4] + row1[i] + row1[i + 4]);
+                }
+            }
+
+            uint8_t* level = &*out.insert(out.end(), size_t(w) * h * 4, 0);
+            for (uint32_t ty = 0; ty < tilesY; ty++) {
+                for (uint32_t tx = 0; tx < tilesX; tx++) {
+                    auto covered = [&](float scale) {
+                        uint32_t n = 0;
+                        for (uint32_t y = ty * t; y < (ty + 1) * t; y++) {
+                            for (uint32_t x = tx * t; x < (tx + 1) * t; x++) {
+                                n += alpha(cur[(size_t(y) * w + x) * 4 + 3], scale) > 127;
+                            }
+                        }
+                        return float(n) / float(t * t);
+                    };
+
+                    // more scale never covers less, so bisect for the smallest one that reaches the full size
+                    float lo = 0.0f, hi = 255.0f;
+                    for (int i = 0; i < 20; i++) {
+                        const float mid = 0.5f * (lo + hi);
+                        (covered(mid) >= target[ty * tilesX + tx] ? hi : lo) = mid;
+                    }
+
+                    for (uint32_t y = ty * t; y < (ty + 1) * t; y++) {
+                        for (uint32_t x = tx * t; x < (tx + 1) * t; x++) {
+                            const size_t i = (size_t(y) * w + x) * 4;
+                            for (uint32_t c = 0; c < 3; c++) {
+                                level[i + c] = uint8_t(cur[i + c] + 0.5f);
+                            }
+                            level[i + 3] = alpha(cur[i + 3], hi);
+                        }
+                    }
+                }
+            }
+            prev = std::move(cur);
+        }
+        return out;
+    }
+}
+
+VkSpecializationInfo appvk::impostorSpecInfo() const {
+    static const impostorConstants constants{ impostorAzimuths, impostorElevations, impostorCardHeight };
+    static const VkSpecializationMapEntry entries[3] = {
+        { 0, offsetof(impostorConstants, azimuths), sizeof(uint32_t) },
+        { 1, offsetof(impostorConstants, elevations), sizeof(uint32_t) },
+        { 2, offsetof(impostorConstants, cardHeight), sizeof(float) },
+    };
+
+    VkSpecializationInfo info{};
+    info.mapEntryCount = 3;
+    info.pMapEntries = entries;
+    info.dataSize = sizeof(constants);
+    info.pData = &constants;
+    return info;
+}
+
+// renders the impostor atlas once at load time, see shader/impostorbake.vert. each view is an impostorTexels
+// tile, azimuths along x and elevations along y, drawn with its own viewport in one render pass. the pass, its
+// pipeline and the depth buffer are only needed here, the two atlas images stay for impostor.frag.
+// both get mips down to a texel per view, color blitted on the GPU, normal and coverage by coverageMips.
+void appvk::bakeImpostors() {
+    const uint32_t width = impostorAzimuths * impostorTexels;
+    const uint32_t height = impostorElevations * impostorTexels;
+    const uint32_t levels = uint32_t(floor(log2(impostorTexels))) + 1;
+    const VkFormat colorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    const VkFormat normalFormat = VK_FORMAT_R8G8B8A8_UNORM; // a direction and coverage, not a color
+
+    const VkImageUsageFlags atlasUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+        | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    createImage(width, height, colorFormat, levels, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+        atlasUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mem::texture, impostorColorImage, impostorColorMem);
+    createImage(width, height, normalFormat, levels, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+        atlasUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mem::texture, impostorNormalImage, impostorNormalMem);
+
+    VkImage bakeDepthImage;
+    VkDeviceMemory bakeDepthMem;
+    createImage(width, height, depthFormat, 1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        mem::attachment, bakeDepthImage, bakeDepthMem);
+
+    impostorColorView = createImageView(impostorColorImage, colorFormat, levels, VK_IMAGE_ASPECT_COLOR_BIT);
+    impostorNormalView = createImageView(impostorNormalImage, normalFormat, levels, VK_IMAGE_ASPECT_COLOR_BIT);
+    VkImageView bakeColorView = createImageView(impostorColorImage, colorFormat, 1, VK_IMAGE_ASPECT_COLOR_BIT); // level 0 only
+    VkImageView bakeNormalView = createImageView(impostorNormalImage, normalFormat, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+    VkImageView bakeDepthView = createImageView(bakeDepthImage, depthFormat, 1, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    // impostor.frag clamps to the view's tile, which only holds for a footprint without anisotropy
+    VkSamplerCreateInfo sampInfo{};
+    sampInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampInfo.magFilter = VK_FILTER_LINEAR;
+    sampInfo.minFilter = VK_FILTER_LINEAR;
+    sampInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampInfo.anisotropyEnable = VK_FALSE;
+    sampInfo.maxAnisotropy = 1.0f;
+    sampInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+    sampInfo.minLod = 0.0f;
+    sampInfo.maxLod = float(levels);
+    if (vkCreateSampler(dev, &sampInfo, nullptr, &impostorSamp) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create impostor sampler!");
+    }
+
+    VkAttachmentDescription attachments[3] = {};
+
+    // level 0 of both atlas images ends up ready for the mips
+    attachments[0].format = colorFormat;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; // coverage 0 wherever no blade is
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL; // generateMipmaps starts from there
+
+    attachments[1] = attachments[0];
+    attachments[1].format = normalFormat;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; // read back for coverageMips
+
+    attachments[2] = attachments[0];
+    attachments[2].format = depthFormat;
+    attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[2].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorRefs[2];
+    colorRefs[0].attachment = 0;
+    colorRefs[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorRefs[1].attachment = 1;
+    colorRefs[1].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthRef;
+    depthRef.attachment = 2;
+    depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription sub{};
+    sub.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    sub.colorAttachmentCount = 2;
+    sub.pColorAttachments = colorRefs;
+    sub.pDepthStencilAttachment = &depthRef;
+
+    // the mips are made from the bake by transfers
+    VkSubpassDependency dep{};
+    dep.srcSubpass = 0;
+    dep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dep.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dep.dstSubpass = VK_SUBPASS_EXTERNAL;
+    dep.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dep.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    VkRenderPassCreateInfo passInfo{};
+    passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    passInfo.attachmentCount = 3;
+    passInfo.pAttachments = attachments;
+    passInfo.subpassCount = 1;
+    passInfo.pSubpasses = &sub;
+    passInfo.dependencyCount = 1;
+    passInfo.pDependencies = &dep;
+
+    VkRenderPass bakePass;
+    if (vkCreateRenderPass(dev, &passInfo, nullptr, &bakePass) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create impostor render pass!");
+    }
+
+    VkImageView views[] = { bakeColorView, bakeNormalView, bakeDepthView };
+
+    VkFramebufferCreateInfo fbInfo{};
+    fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    fbInfo.renderPass = bakePass;
+    fbInfo.attachmentCount = 3;
+    fbInfo.pAttachments = views;
+    fbInfo.width = width;
+    fbInfo.height = height;
+    fbInfo.layers = 1;
+
+    VkFramebuffer fb;
+    if (vkCreateFramebuffer(dev, &fbInfo, nullptr, &fb) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create impostor framebuffer!");
+    }
+
+    VkPipelineShaderStageCreateInfo shaders[2] = {};
+    shaders[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaders[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaders[0].module = loadShaderModule(".spv/impostorbake.vert.spv");
+    shaders[0].pName = "main";
+    const VkSpecializationInfo atlasSpec = impostorSpecInfo();
+    shaders[0].pSpecializationInfo = &atlasSpec;
+
+    shaders[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaders[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaders[1].module = loadShaderModule(".spv/impostorbake.frag.spv");
+    shaders[1].pName = "main";
+
+    // the grass model, same as field grass reads it
+    VkVertexInputBindingDescription bindDesc;
+    bindDesc.binding = 0;
+    bindDesc.stride = sizeof(vformat::vertex);
+    bindDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription attrDesc[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        attrDesc[i].location = i;
+        attrDesc[i].binding = 0;
+        attrDesc[i].offset = 16 * i;
+    }
+    attrDesc[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attrDesc[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attrDesc[2].format = VK_FORMAT_R32G32_SFLOAT;
+
+    VkPipelineVertexInputStateCreateInfo vinInfo{};
+    vinInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vinInfo.vertexBindingDescriptionCount = 1;
+    vinInfo.pVertexBindingDescriptions = &bindDesc;
+    vinInfo.vertexAttributeDescriptionCount = 3;
+    vinInfo.pVertexAttributeDescriptions = attrDesc;
+
+    VkPipelineInputAssemblyStateCreateInfo inAsmInfo{};
+    inAsmInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inAsmInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // set per view
+    VkPipelineViewportStateCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewInfo.viewportCount = 1;
+    viewInfo.scissorCount = 1;
+
+    VkDynamicState dynStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynInfo{};
+    dynInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynInfo.dynamicStateCount = 2;
+    dynInfo.pDynamicStates = dynStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterInfo{};
+    rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterInfo.cullMode = VK_CULL_MODE_NONE; // blades are seen from both sides, like in the grass pipeline
+    rasterInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterInfo.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo msInfo{};
+    msInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    msInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthInfo{};
+    depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthInfo.depthTestEnable = VK_TRUE;
+    depthInfo.depthWriteEnable = VK_TRUE;
+    depthInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    // alpha tested, nothing to blend
+    VkPipelineColorBlendAttachmentState blendAttachments[2] = {};
+    blendAttachments[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    blendAttachments[1] = blendAttachments[0];
+
+    VkPipelineColorBlendStateCreateInfo blendInfo{};
+    blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    blendInfo.attachmentCount = 2;
+    blendInfo.pAttachments = blendAttachments;
+
+    VkGraphicsPipelineCreateInfo pipeInfo{};
+    pipeInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeInfo.stageCount = 2;
+    pipeInfo.pStages = shaders;
+    pipeInfo.pVertexInputState = &vinInfo;
+    pipeInfo.pInputAssemblyState = &inAsmInfo;
+    pipeInfo.pViewportState = &viewInfo;
+    pipeInfo.pRasterizationState = &rasterInfo;
+    pipeInfo.pMultisampleState = &msInfo;
+    pipeInfo.pDepthStencilState = &depthInfo;
+    pipeInfo.pColorBlendState = &blendInfo;
+    pipeInfo.pDynamicState = &dynInfo;
+    pipeInfo.layout = grassPipeLayout; // grass texture in grassSet, grassField as push constants
+    pipeInfo.renderPass = bakePass;
+    pipeInfo.subpass = 0;
+
+    vkr::pipeline bakePipe;
+    createPipelines({ pipeInfo }, { &bakePipe });
+
+    VkCommandBuffer cmd = beginSingleCommand();
+
+    VkClearValue clears[3] = {};
+    clears[2].depthStencil = { 1.0f, 0 };
+
+    VkRenderPassBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    beginInfo.renderPass = bakePass;
+    beginInfo.framebuffer = fb;
+    beginInfo.renderArea.extent = { width, height };
+    beginInfo.clearValueCount = 3;
+    beginInfo.pClearValues = clears;
+
+    vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkDeviceSize offset = 0;
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, bakePipe);
+    vkCmdBindVertexBuffers(cmd, 0, 1, &grassVertBuf, &offset);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, grassPipeLayout, 0, 1, &grassSet[0], 0, nullptr);
+    vkCmdPushConstants(cmd, grassPipeLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(grassField), &grassField);
+
+    // the view index rides along in the instance index, see impostorbake.vert
+    const uint32_t blades = grassField.cardCells * grassField.cardCells;
+    for (uint32_t v = 0; v < impostorAzimuths * impostorElevations; v++) {
+        VkViewport viewport{};
+        viewport.x = (v % impostorAzimuths) * impostorTexels;
+        viewport.y = (v / impostorAzimuths) * impostorTexels;
+        viewport.width = impostorTexels;
+        viewport.height = impostorTexels;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+
+        VkRect2D scissor{};
+        scissor.offset = { int32_t(viewport.x), int32_t(viewport.y) };
+        scissor.extent = { impostorTexels, impostorTexels };
+
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+        vkCmdDraw(cmd, grassVertices, blades, 0, v * blades);
+    }
+
+    vkCmdEndRenderPass(cmd);
+
+    // the levels below the bake are written by transfers only
+    VkImageMemoryBarrier toMips[2] = {};
+    for (uint32_t i = 0; i < 2; i++) {
+        toMips[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        toMips[i].srcAccessMask = 0;
+        toMips[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toMips[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        toMips[i].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        toMips[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toMips[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toMips[i].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 1, levels - 1, 0, 1 };
+    }
+    toMips[0].image = impostorColorImage;
+    toMips[1].image = impostorNormalImage;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, toMips);
+
+    // the normal bake goes to the CPU, see coverageMips
+    const VkDeviceSize baseSize = VkDeviceSize(width) * height * 4;
+    VkBuffer readBuf;
+    VkDeviceMemory readMem;
+    createBuffer(baseSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        mem::staging, readBuf, readMem);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { width, height, 1 };
+    vkCmdCopyImageToBuffer(cmd, impostorNormalImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readBuf, 1, &region);
+
+    VkMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, nullptr, 0, nullptr);
+
+    endSingleCommand(cmd);
+
+    vkDestroyFramebuffer(dev, fb, nullptr);
+    vkDestroyRenderPass(dev, bakePass, nullptr);
+    vkDestroyImageView(dev, bakeColorView, nullptr);
+    vkDestroyImageView(dev, bakeNormalView, nullptr);
+    vkDestroyImageView(dev, bakeDepthView, nullptr);
+    vkDestroyImage(dev, bakeDepthImage, nullptr);
+    freeMemory(bakeDepthMem);
+
+    // a plain box filter is right for color, blade texels are premultiplied by coverage against the black clear
+    generateMipmaps(impostorColorImage, colorFormat, width, height, levels, 1);
+
+    void* data;
+    vkMapMemory(dev, readMem, 0, baseSize, 0, &data);
+    const std::vector<uint8_t> mips = coverageMips(static_cast<const uint8_t*>(data), width, height, impostorTexels, levels);
+    vkUnmapMemory(dev, readMem);
+    vkDestroyBuffer(dev, readBuf, nullptr);
+    freeMemory(readMem);
+
+    VkBuffer stagingBuf;
+    VkDeviceMemory stagingMem;
+    createBuffer(mips.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        mem::staging, stagingBuf, stagingMem);
+    vkMapMemory(dev, stagingMem, 0, mips.size(), 0, &data);
+    memcpy(data, mips.data(), mips.size());
+    vkUnmapMemory(dev, stagingMem);
+
+    std::vector<VkBufferImageCopy> regions(levels - 1, VkBufferImageCopy{});
+    VkDeviceSize mipOffset = 0;
+    for (uint32_t l = 1; l < levels; l++) {
+        VkBufferImageCopy& r = regions[l - 1];
+        r.bufferOffset = mipOffset;
+        r.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, l, 0, 1 };
+        r.imageExtent = { width >> l, height >> l, 1 };
+        mipOffset += VkDeviceSize(width >> l) * (height >> l) * 4;
+    }
+
+    cmd = beginSingleCommand();
+    vkCmdCopyBufferToImage(cmd, stagingBuf, impostorNormalImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, uint32_t(regions.size()), regions.data());
+
+    // the grass subpass samples the whole chain from then on
+    VkImageMemoryBarrier toShader[2] = {};
+    for (uint32_t i = 0; i < 2; i++) {
+        toShader[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        toShader[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        toShader[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        toShader[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toShader[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toShader[i].image = impostorNormalImage;
+    }
+    toShader[0].srcAccessMask = 0;
+    toShader[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toShader[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    toShader[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toShader[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toShader[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 1, levels - 1, 0, 1 };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, toShader);
+    endSingleCommand(cmd);
+
+    vkDestroyBuffer(dev, stagingBuf, nullptr);
+    freeMemory(stagingMem);
+
+    cout << "baked " << impostorAzimuths * impostorElevations << " impostor views of " << blades << " blades into a "
+        << width << "x" << height << " atlas\n";
+}
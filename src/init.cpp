@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring> // for strcmp
 #include <set>
 
@@ -27,6 +28,7 @@ void appvk::createWindow() {
     // (since static members have no implicit "*this" parameter)
     glfwSetWindowUserPointer(w, this);
     glfwSetFramebufferSizeCallback(w, windowSizeCallback);
+    glfwGetFramebufferSize(w, &fbWidth, &fbHeight);
 }
 
 void appvk::checkValidation() {
@@ -283,8 +285,32 @@ void appvk::createLogicalDevice() {
     float pri = 1.0f;
     queueInfo.pQueuePriorities = &pri; // highest priority
 
+    // frame completion is tracked with a timeline semaphore (core in 1.2)
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline{};
+    timeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timeline.timelineSemaphore = VK_TRUE;
+
+    // fp16 arithmetic in shaders (core in 1.2), only turned on if the device has it
+    VkPhysicalDeviceShaderFloat16Int8Features halfSupport{};
+    halfSupport.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES;
+    VkPhysicalDeviceFeatures2 supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported.pNext = &halfSupport;
+    vkGetPhysicalDeviceFeatures2(pdev, &supported);
+
+    float16 = settings.halfShading && halfSupport.shaderFloat16;
+    if (settings.halfShading) {
+        precision = float16 ? fragPrecision::half : fragPrecision::relaxed;
+    }
+
+    VkPhysicalDeviceShaderFloat16Int8Features half{};
+    half.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES;
+    half.pNext = &timeline;
+    half.shaderFloat16 = float16;
+
     VkPhysicalDevicePipelineExecutablePropertiesFeaturesKHR execProp{};
     execProp.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PIPELINE_EXECUTABLE_PROPERTIES_FEATURES_KHR;
+    execProp.pNext = &half;
     execProp.pipelineExecutableInfo = VK_TRUE;
 
     // this structure is the same as deviceFeatures but has a pNext member too
@@ -294,61 +320,131 @@ void appvk::createLogicalDevice() {
     feat2.features = {}; // set everything not used to zero
     feat2.features.samplerAnisotropy = VK_TRUE;
 
+    // add any optional extensions the device has to the required ones
+    uint32_t numExtensions;
+    vkEnumerateDeviceExtensionProperties(pdev, nullptr, &numExtensions, nullptr);
+    std::vector<VkExtensionProperties> deviceExtensions(numExtensions);
+    vkEnumerateDeviceExtensionProperties(pdev, nullptr, &numExtensions, deviceExtensions.data());
+
+    std::vector<const char*> extensions(requiredExtensions.begin(), requiredExtensions.end());
+    for (const auto& optional : optionalExtensions) {
+        for (const auto& extension : deviceExtensions) {
+            if (!strcmp(optional, extension.extensionName)) {
+                extensions.push_back(optional);
+            }
+        }
+    }
+
+    auto enabled = [&](const char* name) {
+        return std::find_if(extensions.begin(), extensions.end(), [&](const char* e) { return !strcmp(e, name); }) != extensions.end();
+    };
+    memoryBudget = enabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pNext = &feat2;
     createInfo.pQueueCreateInfos = &queueInfo;
     createInfo.queueCreateInfoCount = 1;
     createInfo.pEnabledFeatures = nullptr;
-    createInfo.enabledExtensionCount = requiredExtensions.size();
-    createInfo.ppEnabledExtensionNames = requiredExtensions.data();
+    createInfo.enabledExtensionCount = extensions.size();
+    createInfo.ppEnabledExtensionNames = extensions.data();
             
     if (vkCreateDevice(pdev, &createInfo, nullptr, &dev)) {
         throw std::runtime_error("cannot create virtual device!");
     }
 
+    mtrack.init(pdev, memoryBudget);
+    cacheMemoryProperties();
+    gpuTimes.init(pdev, dev, *(qi.graphics));
+    shaders.init(dev);
+
     vkGetDeviceQueue(dev, *(qi.graphics), 0, &gQueue); // creating a device also creates queues for it
 }
 
 appvk::~appvk() {
 
+    mtrack.report(cout); // report footprint before anything gets freed
+    reportFrameTimes();
+
+    vkDeviceWaitIdle(dev);
+    deletions.flush();
+
     cleanupSwapChain();
 
+    vkDestroyPipelineCache(dev, pipeCache, nullptr);
+
     vkDestroyDescriptorSetLayout(dev, dSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(dev, grassSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(dev, windSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(dev, trampleSetLayout, nullptr);
     vkDestroyDescriptorSetLayout(dev, skySetLayout, nullptr);
 
     vkDestroyCommandPool(dev, cp, nullptr);
 
     vkDestroySampler(dev, terrainSamp, nullptr);
     vkDestroyImageView(dev, terrainView, nullptr);
-    vkFreeMemory(dev, terrainMem, nullptr);
+    freeMemory(terrainMem);
     vkDestroyImage(dev, terrainImage, nullptr);
 
     vkDestroySampler(dev, grassSamp, nullptr);
     vkDestroyImageView(dev, grassView, nullptr);
-    vkFreeMemory(dev, grassMem, nullptr);
+    freeMemory(grassMem);
     vkDestroyImage(dev, grassImage, nullptr);
 
+    windPipe.reset();
+    windPipeLayout.reset();
+    vkDestroySampler(dev, windSamp, nullptr);
+    vkDestroyImageView(dev, windView, nullptr);
+    freeMemory(windMem);
+    vkDestroyImage(dev, windImage, nullptr);
+
+    stampPipe.reset();
+    recoverPipe.reset();
+    tramplePipeLayout.reset();
+    vkDestroySampler(dev, trampleSamp, nullptr);
+    vkDestroyImageView(dev, trampleView, nullptr);
+    freeMemory(trampleMem);
+    vkDestroyImage(dev, trampleImage, nullptr);
+
+    vkDestroySampler(dev, impostorSamp, nullptr);
+    vkDestroyImageView(dev, impostorColorView, nullptr);
+    vkDestroyImageView(dev, impostorNormalView, nullptr);
+    freeMemory(impostorColorMem);
+    freeMemory(impostorNormalMem);
+    vkDestroyImage(dev, impostorColorImage, nullptr);
+    vkDestroyImage(dev, impostorNormalImage, nullptr);
+
+    vkDestroySampler(dev, heightSamp, nullptr);
+    vkDestroyImageView(dev, heightView, nullptr);
+    freeMemory(heightMem);
+    vkDestroyImage(dev, heightImage, nullptr);
+
     vkDestroySampler(dev, cubeSamp, nullptr);
     vkDestroyImageView(dev, cubeView, nullptr);
-    vkFreeMemory(dev, cubeMem, nullptr);
+    freeMemory(cubeMem);
     vkDestroyImage(dev, cubeImage, nullptr);
 
-    vkFreeMemory(dev, terrainIndMem, nullptr);
+    freeMemory(terrainIndMem);
     vkDestroyBuffer(dev, terrainIndBuf, nullptr);
 
-    vkFreeMemory(dev, terrainVertMem, nullptr);
+    freeMemory(terrainVertMem);
     vkDestroyBuffer(dev, terrainVertBuf, nullptr);
 
-    vkFreeMemory(dev, grassVertMem, nullptr);
+    freeMemory(grassVertMem);
     vkDestroyBuffer(dev, grassVertBuf, nullptr);
 
-    vkFreeMemory(dev, grassVertInstMem, nullptr);
+    freeMemory(grassVertInstMem);
     vkDestroyBuffer(dev, grassVertInstBuf, nullptr);
+    freeMemory(grassDrawMem);
+    vkDestroyBuffer(dev, grassDrawBuf, nullptr);
+    freeMemory(clumpIndMem);
+    vkDestroyBuffer(dev, clumpIndBuf, nullptr);
 
-    vkFreeMemory(dev, skyVertMem, nullptr);
+    freeMemory(skyVertMem);
     vkDestroyBuffer(dev, skyVertBuf, nullptr);
 
+    shaders.destroy();
+
     vkDestroyDevice(dev, nullptr);
     vkDestroySurfaceKHR(instance, surf, nullptr);
 
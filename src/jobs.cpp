@@ -0,0 +1,199 @@
+#include <algorithm>
+
+#include "jobs.hpp"
+
+namespace {
+    // which pool and queue the current thread works from, external threads use the pool's last queue
+    thread_local const jobs::pool* currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+jobs::pool::pool(unsigned int threads) {
+    threads = std::max(threads, 1u);
+
+    for (unsigned int i = 0; i <= threads; i++) {
+        queues.push_back(std::make_unique<queue>());
+    }
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.emplace_back(&pool::workerLoop, this, i);
+    }
+}
+
+jobs::pool::~pool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+jobs::handle jobs::pool::submit(std::function<void()> fn, std::initializer_list<handle> deps) {
+    return submit(std::move(fn), std::vector<handle>(deps));
+}
+
+jobs::handle jobs::pool::submit(std::function<void()> fn, const std::vector<handle>& deps) {
+    auto h = std::make_shared<job>();
+    h->fn = std::move(fn);
+
+    for (const auto& dep : deps) {
+        addDependency(h, dep);
+    }
+    release(h); // drop the initial count, schedules the job if every dependency is already done
+
+    return h;
+}
+
+void jobs::pool::addDependency(const handle& h, const handle& dep) {
+    if (!dep) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(dep->m);
+    if (dep->finished.load(std::memory_order_acquire)) {
+        return;
+    }
+    h->pendingDeps.fetch_add(1, std::memory_order_relaxed);
+    dep->dependents.push_back(h);
+}
+
+void jobs::pool::release(const handle& h) {
+    if (h->pendingDeps.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        push(h);
+    }
+}
+
+void jobs::pool::push(handle h) {
+    queue& q = *queues[queueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(q.m);
+        q.jobs.push_back(std::move(h));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+
+    // take the lock so a worker can't miss the wakeup between checking for work and going to sleep
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+jobs::handle jobs::pool::pop(size_t self) {
+    // own work first, newest first
+    {
+        queue& q = *queues[self];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (!q.jobs.empty()) {
+            handle h = std::move(q.jobs.back());
+            q.jobs.pop_back();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return h;
+        }
+    }
+
+    // then steal the oldest work from everyone else
+    for (size_t i = 1; i < queues.size(); i++) {
+        queue& q = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (!q.jobs.empty()) {
+            handle h = std::move(q.jobs.front());
+            q.jobs.pop_front();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return h;
+        }
+    }
+
+    return nullptr;
+}
+
+bool jobs::pool::runOne(size_t self) {
+    handle h = pop(self);
+    if (!h) {
+        return false;
+    }
+    run(h);
+    return true;
+}
+
+void jobs::pool::run(const handle& h) {
+    try {
+        h->fn();
+    } catch (...) {
+        h->error = std::current_exception();
+    }
+    h->fn = nullptr; // free captures now, the handle might be kept around for a while
+
+    std::vector<handle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(h->m);
+        h->finished.store(true, std::memory_order_release);
+        dependents.swap(h->dependents);
+    }
+
+    // dependents run even if this job threw, waiting on them reports their own errors
+    for (const auto& d : dependents) {
+        release(d);
+    }
+}
+
+void jobs::pool::workerLoop(size_t self) {
+    currentPool = this;
+    currentQueue = self;
+
+    while (true) {
+        if (runOne(self)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping && queued.load(std::memory_order_acquire) == 0) {
+            return; // whatever was submitted still runs before the pool goes away
+        }
+    }
+}
+
+size_t jobs::pool::queueIndex() const {
+    return currentPool == this ? currentQueue : queues.size() - 1;
+}
+
+void jobs::pool::wait(const handle& h) {
+    const size_t self = queueIndex();
+    while (!h->done()) {
+        if (!runOne(self)) {
+            std::this_thread::yield(); // what's left is running on other threads
+        }
+    }
+
+    if (h->error) {
+        std::rethrow_exception(h->error);
+    }
+}
+
+void jobs::pool::wait(const std::vector<handle>& hs) {
+    // let everything finish before rethrowing, the jobs might reference the caller's stack
+    const size_t self = queueIndex();
+    for (const auto& h : hs) {
+        while (!h->done()) {
+            if (!runOne(self)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    for (const auto& h : hs) {
+        if (h->error) {
+            std::rethrow_exception(h->error);
+        }
+    }
+}
+
+void jobs::pool::parallelFor(size_t n, const std::function<void(size_t)>& fn) {
+    std::vector<handle> hs;
+    hs.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        hs.push_back(submit([&fn, i] { fn(i); }));
+    }
+    wait(hs);
+}
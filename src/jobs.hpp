@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jobs {
+    class pool;
+
+    // one unit of work. it runs once every job it depends on has finished.
+    class job {
+    public:
+        bool done() const { return finished.load(std::memory_order_acquire); }
+
+    private:
+        friend class pool;
+
+        std::function<void()> fn;
+        std::exception_ptr error;
+
+        // starts at 1 so the job can't run while its dependencies are still being added
+        std::atomic<int> pendingDeps{1};
+        std::atomic<bool> finished{false};
+
+        std::mutex m; // guards dependents against the job finishing while they are added
+        std::vector<std::shared_ptr<job>> dependents;
+    };
+
+    using handle = std::shared_ptr<job>;
+
+    // work-stealing thread pool. every worker owns a deque: it pushes and pops its own work at the back
+    // (newest first, which keeps caches warm for job chains), idle workers steal from the front of the others.
+    // threads waiting on a job help out with other work instead of blocking, so waiting from inside a job is fine.
+    // destroying the pool runs everything still queued first.
+    class pool {
+    public:
+        explicit pool(unsigned int threads = std::thread::hardware_concurrency());
+        ~pool();
+
+        pool(const pool&) = delete;
+        pool& operator=(const pool&) = delete;
+
+        handle submit(std::function<void()> fn, std::initializer_list<handle> deps = {});
+        handle submit(std::function<void()> fn, const std::vector<handle>& deps);
+
+        // runs fn(i) for every i in [0, n), returns once they are all done
+        void parallelFor(size_t n, const std::function<void(size_t)>& fn);
+
+        // rethrows if the job threw
+        void wait(const handle& h);
+        void wait(const std::vector<handle>& hs);
+
+        unsigned int size() const { return workers.size(); }
+
+    private:
+        struct queue {
+            std::mutex m;
+            std::deque<handle> jobs;
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<queue>> queues; // one per worker, plus one for threads outside the pool
+
+        std::atomic<size_t> queued{0};
+        std::atomic<bool> stopping{false};
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+
+        void addDependency(const handle& h, const handle& dep);
+        void release(const handle& h); // drop one pending dependency, schedule once there are none left
+
+        void push(handle h);
+        handle pop(size_t self);
+        bool runOne(size_t self);
+        void run(const handle& h);
+
+        void workerLoop(size_t self);
+        size_t queueIndex() const; // the calling thread's own queue
+    };
+}
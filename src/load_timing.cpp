@@ -0,0 +1,56 @@
+#include <algorithm>
+
+#include "load_timing.hpp"
+
+load::timeline::entry* load::timeline::add(std::string name, std::vector<const entry*> deps) {
+    deps.erase(std::remove(deps.begin(), deps.end(), nullptr), deps.end()); // steps that were skipped
+    entries.push_back(entry{std::move(name), std::move(deps), entries.size(), {}, {}});
+    return &entries.back();
+}
+
+std::function<void()> load::timeline::timed(entry* e, std::function<void()> fn) {
+    return [e, fn = std::move(fn)] {
+        e->start();
+        fn();
+        e->finish();
+    };
+}
+
+void load::timeline::report(std::ostream& os) const {
+    auto since = [this](clock::time_point t) { return std::chrono::duration<double, std::milli>(t - origin).count(); };
+
+    // dependencies are always added before their dependents, so one pass in order finds the longest chain
+    std::vector<double> chain(entries.size(), 0.0);
+    std::vector<const entry*> prev(entries.size(), nullptr);
+    double wall = 0.0;
+
+    os << "startup loading:\n";
+    for (const auto& e : entries) {
+        for (const entry* d : e.deps) {
+            if (chain[d->index] > chain[e.index]) {
+                chain[e.index] = chain[d->index];
+                prev[e.index] = d;
+            }
+        }
+        chain[e.index] += e.ms();
+        wall = std::max(wall, since(e.end));
+
+        os << "\t" << e.name << ": " << e.ms() << " ms (" << since(e.begin) << " to " << since(e.end) << " ms)\n";
+    }
+
+    if (entries.empty()) {
+        return;
+    }
+
+    const size_t last = std::max_element(chain.begin(), chain.end()) - chain.begin();
+    std::vector<const entry*> path;
+    for (const entry* e = &entries[last]; e; e = prev[e->index]) {
+        path.push_back(e);
+    }
+
+    os << "\tcritical path " << chain[last] << " ms of " << wall << " ms total: ";
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        os << (it == path.rbegin() ? "" : " -> ") << (*it)->name;
+    }
+    os << "\n";
+}
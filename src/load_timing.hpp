@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace load {
+    // records when each step of startup loading ran, and which steps it had to wait for,
+    // to find the chain of steps that bounds startup time no matter how many cores there are.
+    class timeline {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct entry {
+            std::string name;
+            std::vector<const entry*> deps;
+            size_t index;
+            clock::time_point begin, end;
+
+            void start() { begin = clock::now(); }
+            void finish() { end = clock::now(); }
+            double ms() const { return std::chrono::duration<double, std::milli>(end - begin).count(); }
+        };
+
+        timeline() : origin(clock::now()) {}
+
+        // entries never move, so jobs can fill in their own entry while more are added.
+        // null deps are ignored, for steps that didn't need to run.
+        entry* add(std::string name, std::vector<const entry*> deps = {});
+
+        // wraps a job body so its run time lands in e
+        static std::function<void()> timed(entry* e, std::function<void()> fn);
+
+        void report(std::ostream& os) const;
+
+    private:
+        clock::time_point origin;
+        std::deque<entry> entries;
+    };
+}
@@ -1,16 +1,52 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <thread>
+#include <exception>
+#include <memory>
+
 #include "vloader.hpp"
 
+#include "alloc_track.hpp"
+#include "load_timing.hpp"
+
 #include "main.hpp"
 
+// wait until the window isn't hidden anymore, returns false if the app is closing in the meantime
+bool appvk::waitForWindow() {
+	if (!settings.renderThread) {
+		glfwGetFramebufferSize(w, &fbWidth, &fbHeight);
+		while (fbWidth == 0 || fbHeight == 0) {
+			glfwWaitEvents(); // put this thread to sleep until events exist
+			glfwGetFramebufferSize(w, &fbWidth, &fbHeight);
+			if (glfwWindowShouldClose(w)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// glfw belongs to the main thread, so wait for it to tell us about the new size
+	while (latestInput.fbWidth == 0 || latestInput.fbHeight == 0) {
+		if (stopRender) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::duration<double>(tickSeconds));
+		inputs.consume(latestInput);
+	}
+	fbWidth = latestInput.fbWidth;
+	fbHeight = latestInput.fbHeight;
+	return true;
+}
+
 void appvk::recreateSwapChain() {
-	int width, height;
-	glfwGetFramebufferSize(w, &width, &height);
-	while (width == 0 || height == 0) { // wait until window isn't hidden anymore
-		glfwGetFramebufferSize(w, &width, &height);
-		glfwWaitEvents(); // put this thread to sleep until events exist
+	if (!waitForWindow()) {
+		return; // the old swapchain gets cleaned up with everything else
 	}
 
 	vkDeviceWaitIdle(dev);
+	deletions.collect(submittedSerial);
 
 	cleanupSwapChain();
 
@@ -24,19 +60,167 @@ void appvk::recreateSwapChain() {
 	createUniformBuffers();
 	createDescriptorPools();
 	allocDescriptorSets(dPool, terrainSet, dSetLayout);
-	allocDescriptorSets(dPool, grassSet, dSetLayout);
+	allocDescriptorSets(dPool, grassSet, grassSetLayout);
 	allocDescriptorSets(skyPool, skySet, skySetLayout);
+	allocDescriptorSets(dPool, windSet, windSetLayout);
+	allocDescriptorSets(dPool, trampleSet, trampleSetLayout);
 	allocDescriptorSetUniform(terrainSet);
 	allocDescriptorSetUniform(grassSet);
 	allocDescriptorSetUniform(skySet);
+	allocDescriptorSetUniform(windSet);
 	allocDescriptorSetTexture(terrainSet, terrainSamp, terrainView);
 	allocDescriptorSetTexture(grassSet, grassSamp, grassView);
+	if (heightView) {
+		allocDescriptorSetTexture(grassSet, heightSamp, heightView, 2);
+	}
+	if (impostors) {
+		allocDescriptorSetTexture(grassSet, impostorSamp, impostorColorView, 5);
+		allocDescriptorSetTexture(grassSet, impostorSamp, impostorNormalView, 6);
+	}
 	allocDescriptorSetTexture(skySet, cubeSamp, cubeView);
+	allocDescriptorSetWind();
+	allocDescriptorSetTrample();
 	allocRenderCmdBuffers();
 	createSyncs();
 }
 
-appvk::appvk() : c(0.0f, 1.618f, -9.764f) {
+appvk::appvk(const options::runtime& settings) : settings(settings), quality(settings.shading), windOn(settings.wind), framesInFlight(settings.framesInFlight), c(0.0f, 1.618f, -9.764f),
+	tickSeconds(1.0 / settings.tickRate) {
+
+	// file reads, image decoding, model parsing and terrain and grass generation don't touch vulkan,
+	// so start them all right away and let them overlap with device setup
+	load::timeline loadTimes;
+
+	// everything the jobs read or write lives up here, ahead of loadGuard, so it outlives them
+	uint8_t feats = ter::terrain::features::normal | ter::terrain::features::uv;
+	unsigned int nw = 128, nh = 128;
+	std::vector<uint16_t> heights;
+	std::string_view grassPath = "models/vertical-quad.obj";
+	std::unique_ptr<vload::vloader> g;
+	std::string_view skyPath = "models/cube.obj";
+	std::unique_ptr<vload::vloader> s;
+	std::string_view terrainFloor = "textures/floor-diffuse-1k.jpg";
+	decodedImage terrainPixels;
+	std::string_view grassTex = "textures/grass-billboard.png";
+	decodedImage grassPixels;
+	std::string_view densityTex = "textures/grass-density.png"; // only needed while scattering grass, so it never goes into the pack
+	decodedImage densityPixels;
+	const std::array<std::string_view, 6>& skyTex = pack::cubemapFaces; // the pack is checked against the same files
+	std::array<decodedImage, 6> skyPixels;
+
+	// if anything throws before the uploads are submitted (vulkan setup, or a job's error rethrown by wait),
+	// the jobs still running have to finish before the locals above go away, and the open upload batch is dropped
+	std::vector<jobs::handle> loadJobs;
+	struct loadGuard {
+		appvk& app;
+		std::vector<jobs::handle>& jobs;
+		~loadGuard() {
+			for (const auto& h : jobs) {
+				try {
+					app.workers.wait(h);
+				} catch (...) {
+					// already unwinding from the first error
+				}
+			}
+			if (app.uploadCmd != VK_NULL_HANDLE) {
+				app.discardUploadBatch();
+			}
+		}
+	} guard{*this, loadJobs};
+	auto submit = [&](std::function<void()> fn, const std::vector<jobs::handle>& deps = {}) {
+		return loadJobs.emplace_back(workers.submit(std::move(fn), deps));
+	};
+
+	auto* terrainTime = loadTimes.add("generate terrain");
+	const jobs::handle terrainJob = submit(load::timeline::timed(terrainTime, [&] {
+		t.regen(nw, nh, 50.0f, 50.0f, feats);
+		glm::vec2 lo(INFINITY), hi(-INFINITY);
+		for (const auto& v : t.verts) {
+			lo = glm::min(lo, glm::vec2(v.pos.x, v.pos.z));
+			hi = glm::max(hi, glm::vec2(v.pos.x, v.pos.z));
+		}
+		terrainOrigin = lo;
+		terrainSize = hi - lo;
+	}));
+
+	// field grass needs the ground height where each blade goes, scatter grass reads it from the terrain buffers instead
+	const bool fieldGrass = settings.grassMode == options::grass::field;
+	load::timeline::entry* heightTime = nullptr;
+	jobs::handle heightJob;
+	if (fieldGrass) {
+		heightTime = loadTimes.add("sample heightmap", {terrainTime});
+		heightJob = submit(load::timeline::timed(heightTime, [&] { heights = sampleHeightmap(); }), {terrainJob});
+	}
+
+	// baked assets need no parsing or decoding, only what is missing from the pack gets loaded from source
+	if (!settings.packPath.empty() && assetPack.open(settings.packPath, sizeof(vformat::vertex))) {
+		cout << "loading assets from " << settings.packPath << "\n";
+	}
+	auto packed = [this](std::string_view name, pack::kind type) -> const pack::entry* {
+		const pack::entry* e = assetPack.find(name);
+		return e && e->type == type ? e : nullptr;
+	};
+
+	// the jobs and timeline entries below stay null for anything that comes from the pack
+	const pack::entry* grassMesh = packed(grassPath, pack::kind::mesh);
+	load::timeline::entry* grassModelTime = nullptr;
+	jobs::handle grassModelJob;
+	if (!grassMesh) {
+		grassModelTime = loadTimes.add("load " + std::string(grassPath));
+		grassModelJob = submit(load::timeline::timed(grassModelTime, [&] { g = std::make_unique<vload::vloader>(grassPath, false, false); }));
+	}
+
+	const pack::entry* skyMesh = packed(skyPath, pack::kind::mesh);
+	load::timeline::entry* skyModelTime = nullptr;
+	jobs::handle skyModelJob;
+	if (!skyMesh) {
+		skyModelTime = loadTimes.add("load " + std::string(skyPath));
+		skyModelJob = submit(load::timeline::timed(skyModelTime, [&] { s = std::make_unique<vload::vloader>(skyPath, false, false); }));
+	}
+
+	const pack::entry* terrainPacked = packed(terrainFloor, pack::kind::image);
+	load::timeline::entry* terrainTexTime = nullptr;
+	jobs::handle terrainTexJob;
+	if (!terrainPacked) {
+		terrainTexTime = loadTimes.add("decode " + std::string(terrainFloor));
+		terrainTexJob = submit(load::timeline::timed(terrainTexTime, [&] { terrainPixels = decodeImage(terrainFloor, false); }));
+	}
+
+	const pack::entry* grassPacked = packed(grassTex, pack::kind::image);
+	load::timeline::entry* grassTexTime = nullptr;
+	jobs::handle grassTexJob;
+	if (!grassPacked) {
+		grassTexTime = loadTimes.add("decode " + std::string(grassTex));
+		grassTexJob = submit(load::timeline::timed(grassTexTime, [&] { grassPixels = decodeImage(grassTex, true); }));
+	}
+
+	load::timeline::entry* densityTime = nullptr;
+	jobs::handle densityJob;
+	if (!fieldGrass) {
+		densityTime = loadTimes.add("decode " + std::string(densityTex));
+		densityJob = submit(load::timeline::timed(densityTime, [&] { densityPixels = decodeImage(densityTex, false); }));
+	}
+	VkImage densityImage = VK_NULL_HANDLE;
+	VkDeviceMemory densityMem = VK_NULL_HANDLE;
+	VkImageView densityView = VK_NULL_HANDLE;
+	VkSampler densitySamp = VK_NULL_HANDLE;
+
+	const pack::entry* skyPacked = packed(pack::cubemapName, pack::kind::image);
+	std::vector<jobs::handle> skyFaceJobs;
+	std::vector<const load::timeline::entry*> skyFaceTimes;
+	jobs::handle skyTexJob;
+	if (!skyPacked) {
+		for (size_t i = 0; i < 6; i++) {
+			auto* faceTime = loadTimes.add("decode " + std::string(skyTex[i]));
+			skyFaceTimes.push_back(faceTime);
+			skyFaceJobs.push_back(submit(load::timeline::timed(faceTime, [&, i] { skyPixels[i] = decodeImage(skyTex[i], false); })));
+		}
+		skyTexJob = submit([] {}, skyFaceJobs); // done once every face is
+	}
+
+	auto* setupTime = loadTimes.add("vulkan setup");
+	setupTime->start();
+
 	createWindow();
 
 	// disable and center cursor
@@ -49,103 +233,231 @@ appvk::appvk() : c(0.0f, 1.618f, -9.764f) {
 	createSurface();
 	pickPhysicalDevice(nvidia);
 	createLogicalDevice();
+	windZone = gpuTimes.addZone("wind");
+	trampleZone = gpuTimes.addZone("trample");
+	frameZone = gpuTimes.addZone("frame");
 
 	createSwapChain();
 	createSwapViews();
 
 	createRenderPass();
 	createDescriptorSetLayouts();
+	createPipelineCache();
 	createGraphicsPipeline();
 
 	createCommandPool();
+	createWind();
+	createTrample();
 	createDepthImage();
 	createMultisampleImage();
 	createFramebuffers();
 
-	uint8_t feats = ter::terrain::features::normal | ter::terrain::features::uv;
-	unsigned int nw = 128, nh = 128;
-	t.regen(nw, nh, 50.0f, 50.0f, feats);
-	cout << "created terrain with " << nw << "x" << nh << " samples, " << nw * nh << " vertices generated\n";
-
-	std::string_view grassPath = "models/vertical-quad.obj";
-	vload::vloader g(grassPath, false, false);
-	cout << "loaded model " << grassPath << "\n";
-
-	std::string_view skyPath = "models/cube.obj";
-	vload::vloader s(skyPath, false, false);
-	cout << "loaded model " << skyPath << "\n";
-
-	std::tie(terrainVertBuf, terrainVertMem) = createVertexBuffer(t.verts);
-	std::tie(terrainIndBuf, terrainIndMem) = createIndexBuffer(t.indices);
-
-	std::tie(grassVertBuf, grassVertMem) = createVertexBuffer(g.meshList[0].verts);
-
-	std::tie(skyVertBuf, skyVertMem) = createVertexBuffer(s.meshList[0].verts);
-
-	initGrass(t.verts, t.indices);
-	auto bytePtr = reinterpret_cast<uint8_t*>(grassMatBuf.data());
-	std::vector<uint8_t> byteVec(bytePtr, bytePtr + grassMatBuf.size() * sizeof(glm::mat4));
-
-	std::tie(grassVertInstBuf, grassVertInstMem) = createVertexBuffer(byteVec);
-
-	std::string_view terrainFloor = "textures/floor-diffuse-1k.jpg";
-	std::tie(terrainImage, terrainMem, terrainMipLevels) = createTextureImage(terrainFloor, false);
-	cout << "loaded texture " << terrainFloor << "\n";
-	terrainView = createImageView(terrainImage, VK_FORMAT_R8G8B8A8_SRGB, terrainMipLevels, VK_IMAGE_ASPECT_COLOR_BIT);
-	terrainSamp = createSampler(terrainMipLevels);
+	setupTime->finish();
+
+	// record each upload as soon as its data is ready, everything goes to the GPU in one submission at the end
+	struct upload {
+		jobs::handle ready;
+		std::vector<const load::timeline::entry*> deps;
+		std::string name;
+		std::function<void()> record;
+	};
+
+	std::vector<upload> uploads;
+	uploads.push_back({terrainJob, {terrainTime}, "terrain buffers", [&] {
+		// the grass scatter shader reads these too
+		std::tie(terrainVertBuf, terrainVertMem) = createUploadBuffer(t.verts.data(), t.verts.size() * sizeof(vformat::vertex),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, mem::vertex);
+		std::tie(terrainIndBuf, terrainIndMem) = createUploadBuffer(t.indices.data(), t.indices.size() * sizeof(uint32_t),
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, mem::index);
+		cout << "created terrain with " << nw << "x" << nh << " samples, " << nw * nh << " vertices generated\n";
+	}});
+	uploads.push_back({grassModelJob, {grassModelTime}, "grass model buffer", [&] {
+		if (grassMesh) {
+			std::tie(grassVertBuf, grassVertMem) = createVertexBuffer(assetPack.data(*grassMesh), grassMesh->vertexCount() * sizeof(vformat::vertex), mem::vertex);
+			grassVertices = grassMesh->vertexCount();
+			grassIndices = grassMesh->indexCount();
+		} else {
+			std::tie(grassVertBuf, grassVertMem) = createVertexBuffer(g->meshList[0].verts);
+			grassVertices = g->meshList[0].verts.size();
+			grassIndices = g->meshList[0].indices.size();
+		}
+		cout << "loaded model " << grassPath << "\n";
+	}});
+	if (settings.grassClump > 1) {
+		uploads.push_back({nullptr, {}, "grass clump indices", [this] { createClumpIndexBuffer(); }}); // nothing to wait for
+	}
+	uploads.push_back({skyModelJob, {skyModelTime}, "sky model buffer", [&] {
+		if (skyMesh) {
+			std::tie(skyVertBuf, skyVertMem) = createVertexBuffer(assetPack.data(*skyMesh), skyMesh->vertexCount() * sizeof(vformat::vertex), mem::vertex);
+			skyVertices = skyMesh->vertexCount();
+		} else {
+			std::tie(skyVertBuf, skyVertMem) = createVertexBuffer(s->meshList[0].verts);
+			skyVertices = s->meshList[0].verts.size();
+		}
+		cout << "loaded model " << skyPath << "\n";
+	}});
+	uploads.push_back({terrainTexJob, {terrainTexTime}, "terrain texture", [&] {
+		if (terrainPacked) {
+			std::tie(terrainImage, terrainMem, terrainMipLevels) = createPackedImage(*terrainPacked);
+		} else {
+			std::tie(terrainImage, terrainMem, terrainMipLevels) = createTextureImage(terrainPixels, VK_FORMAT_R8G8B8A8_SRGB);
+			terrainPixels = decodedImage{};
+		}
+		cout << "loaded texture " << terrainFloor << "\n";
+		terrainView = createImageView(terrainImage, VK_FORMAT_R8G8B8A8_SRGB, terrainMipLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+		terrainSamp = createSampler(terrainMipLevels);
+	}});
+	uploads.push_back({grassTexJob, {grassTexTime}, "grass texture", [&] {
+		if (grassPacked) {
+			std::tie(grassImage, grassMem, grassMipLevels) = createPackedImage(*grassPacked);
+		} else {
+			std::tie(grassImage, grassMem, grassMipLevels) = createTextureImage(grassPixels, VK_FORMAT_R8G8B8A8_SRGB);
+			grassPixels = decodedImage{};
+		}
+		cout << "loaded texture " << grassTex << "\n";
+		grassView = createImageView(grassImage, VK_FORMAT_R8G8B8A8_SRGB, grassMipLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+		grassSamp = createSampler(grassMipLevels);
+	}});
+	if (fieldGrass) {
+		uploads.push_back({heightJob, {heightTime}, "grass heightmap", [&] {
+			std::tie(heightImage, heightMem) = createHeightmapImage(heights);
+			heights = std::vector<uint16_t>();
+			heightView = createImageView(heightImage, VK_FORMAT_R16_SFLOAT, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+			heightSamp = createSampler(1);
+		}});
+	} else {
+		uploads.push_back({densityJob, {densityTime}, "grass density map", [&] {
+			unsigned int densityMipLevels;
+			std::tie(densityImage, densityMem, densityMipLevels) = createTextureImage(densityPixels, VK_FORMAT_R8G8B8A8_UNORM); // coverage, not a color
+			densityPixels = decodedImage{};
+			densityView = createImageView(densityImage, VK_FORMAT_R8G8B8A8_UNORM, densityMipLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+			densitySamp = createSampler(densityMipLevels);
+		}});
+	}
+	uploads.push_back({skyTexJob, skyFaceTimes, "cubemap texture", [&] {
+		if (skyPacked) {
+			std::tie(cubeImage, cubeMem, std::ignore) = createPackedImage(*skyPacked);
+		} else {
+			std::tie(cubeImage, cubeMem) = createCubemapImage(skyPixels);
+			skyPixels = std::array<decodedImage, 6>{};
+		}
+		cout << "loaded cubemap texture\n";
+		cubeView = createCubeImageView(cubeImage, VK_FORMAT_R8G8B8A8_SRGB);
+		cubeSamp = createSampler(1);
+	}});
+
+	std::vector<const load::timeline::entry*> uploadTimes;
+	beginUploadBatch();
+	while (!uploads.empty()) {
+		// whatever finished first, or help the workers with the oldest one if nothing has
+		// (packed assets have no job, their data is ready as soon as the pack is mapped)
+		auto next = std::find_if(uploads.begin(), uploads.end(), [](const upload& u) { return !u.ready || u.ready->done(); });
+		if (next == uploads.end()) {
+			next = uploads.begin();
+		}
+		if (next->ready) {
+			workers.wait(next->ready);
+		}
 
-	std::string_view grassTex = "textures/grass-billboard.png";
-	std::tie(grassImage, grassMem, grassMipLevels) = createTextureImage(grassTex, true);
-	cout << "loaded texture " << grassTex << "\n";
-	grassView = createImageView(grassImage, VK_FORMAT_R8G8B8A8_SRGB, grassMipLevels, VK_IMAGE_ASPECT_COLOR_BIT);
-	grassSamp = createSampler(grassMipLevels);
+		next->deps.push_back(setupTime);
+		auto* uploadTime = loadTimes.add("record " + next->name, next->deps);
+		uploadTimes.push_back(uploadTime);
+		load::timeline::timed(uploadTime, next->record)();
 
-	std::array<std::string_view, 6> skyTex;
-	skyTex[0] = "textures/right.jpg"; // +x (right)
-	skyTex[1] = "textures/left.jpg"; // -x (left)
-	skyTex[2] = "textures/top.jpg"; // +y (top)
-	skyTex[3] = "textures/bottom.jpg"; // -y (bottom)
-	skyTex[4] = "textures/front.jpg"; // +z (front)
-	skyTex[5] = "textures/back.jpg"; // -z (back)
+		uploads.erase(next);
+	}
 
-	std::tie(cubeImage, cubeMem) = createCubemapImage(skyTex, false);
-	cout << "loaded cubemap texture\n";
+	auto* submitTime = loadTimes.add("submit uploads", uploadTimes);
+	load::timeline::timed(submitTime, [this] { submitUploadBatch(); })();
+
+	if (fieldGrass) {
+		grassField = { terrainOrigin, terrainSize, settings.grassCells, 0x2545f491, 1, settings.grassCells };
+		if (impostors) {
+			// cards are whole cells, the blade window whole cards reaching about impostorDistance past the camera
+			const glm::vec2 cellSize = terrainSize / float(settings.grassCells);
+			const float cell = std::max(cellSize.x, cellSize.y);
+			grassField.cardCells = std::clamp(uint32_t(std::lround(impostorCardSize / cell)), 1u, settings.grassCells);
+			const uint32_t halfCards = uint32_t(std::ceil(settings.impostorDistance / (cell * grassField.cardCells)));
+			grassField.nearSide = std::min(2 * halfCards * grassField.cardCells, settings.grassCells / grassField.cardCells * grassField.cardCells);
+
+			const uint32_t cards = (settings.grassCells + grassField.cardCells - 1) / grassField.cardCells;
+			cout << "drawing " << grassField.nearSide * grassField.nearSide << " of " << settings.grassCells * settings.grassCells
+				<< " field grass instances near the camera, up to " << cards * cards << " impostor cards further out\n";
+		} else {
+			cout << "drawing " << settings.grassCells * settings.grassCells << " field grass instances, no instance buffer\n";
+		}
+	} else {
+		// needs the terrain and grass model on the GPU, and nothing else needs the density map
+		auto* scatterTime = loadTimes.add("scatter grass", {submitTime});
+		load::timeline::timed(scatterTime, [&] { scatterGrass(densityView, densitySamp); })();
+		vkDestroySampler(dev, densitySamp, nullptr);
+		vkDestroyImageView(dev, densityView, nullptr);
+		vkDestroyImage(dev, densityImage, nullptr);
+		freeMemory(densityMem);
+	}
 
-	cubeView = createCubeImageView(cubeImage, VK_FORMAT_R8G8B8A8_SRGB);
-	cubeSamp = createSampler(1);
+	loadTimes.report(cout);
 
 	createUniformBuffers();
 	createDescriptorPools();
 
 	allocDescriptorSets(dPool, terrainSet, dSetLayout);
-	allocDescriptorSets(dPool, grassSet, dSetLayout);
+	allocDescriptorSets(dPool, grassSet, grassSetLayout);
 	allocDescriptorSets(skyPool, skySet, skySetLayout);
+	allocDescriptorSets(dPool, windSet, windSetLayout);
+	allocDescriptorSets(dPool, trampleSet, trampleSetLayout);
 
 	allocDescriptorSetUniform(terrainSet);
 	allocDescriptorSetUniform(grassSet);
 	allocDescriptorSetUniform(skySet);
+	allocDescriptorSetUniform(windSet);
 
 	allocDescriptorSetTexture(terrainSet, terrainSamp, terrainView);
 	allocDescriptorSetTexture(grassSet, grassSamp, grassView);
+	if (heightView) {
+		allocDescriptorSetTexture(grassSet, heightSamp, heightView, 2);
+	}
 	allocDescriptorSetTexture(skySet, cubeSamp, cubeView);
+	allocDescriptorSetWind();
+	allocDescriptorSetTrample();
+
+	// the bake samples the grass texture through grassSet
+	if (impostors) {
+		bakeImpostors();
+		allocDescriptorSetTexture(grassSet, impostorSamp, impostorColorView, 5);
+		allocDescriptorSetTexture(grassSet, impostorSamp, impostorNormalView, 6);
+	}
 
 	terrainIndices = t.indices.size();
-	grassVertices = g.meshList[0].verts.size();
-	grassInstances = grassMatBuf.size();
-	grassIndices = g.meshList[0].indices.size();
-	skyVertices = s.meshList[0].verts.size();
 	allocRenderCmdBuffers();
 
 	createSyncs();
+	cout << framesInFlight << " frames in flight, present mode " << options::presentName(settings.presentMode)
+		<< (settings.lowLatency ? ", low latency pacing" : "") << ", " << options::qualityName(quality) << " quality shading (" << precisionName(precision) << ")"
+		<< (windOn ? ", wind on" : "") << "\n";
+	if (settings.watchShaders) {
+		const char* dir = glsl::compiler::available ? "shader" : ".spv";
+		if (shaderWatch.watch(dir)) {
+			cout << "watching " << dir << "/ for shader changes\n";
+		}
+		if (glsl::compiler::available) {
+			includeWatch.watch("shader/include");
+		}
+	}
+	cout << settings.tickRate << " simulation ticks per second";
+	if (settings.maxFps > 0) {
+		cout << ", rendering at most " << settings.maxFps << " fps";
+	}
+	cout << "\n";
 }
 
-void appvk::drawFrame() {
+bool appvk::drawFrame(const cameraState& cam) {
 
 	// NOTE: acquiring an image, writing to it, and presenting it are all async operations.
 	// The relevant vulkan calls return before the operation completes.
 
-	// wait for a command buffer to finish writing to the current image
-	vkWaitForFences(dev, 1, &inFlightFences[currFrame], VK_FALSE, UINT64_MAX);
+	// paceFrame() has already waited for this frame slot to be free
+	const clock::time_point stallStart = clock::now();
 
 	uint32_t nextFrame;
 	VkResult r = vkAcquireNextImageKHR(dev, swap, UINT64_MAX, imageAvailSems[currFrame], VK_NULL_HANDLE, &nextFrame);
@@ -154,25 +466,45 @@ void appvk::drawFrame() {
 	if (r == VK_ERROR_OUT_OF_DATE_KHR || resizeOccurred) {
 		recreateSwapChain(); // have to recreate the swapchain here
 		resizeOccurred = false;
-		return;
+		return false;
 	} else if (r != VK_SUCCESS && r != VK_SUBOPTIMAL_KHR) { // we can still technically run with a suboptimal swapchain
 		throw std::runtime_error("cannot acquire swapchain image!");
 	}
 
 	// wait for the previous frame to finish using the swapchain image at nextFrame
-	if (imagesInFlight[nextFrame] != VK_NULL_HANDLE) {
-		vkWaitForFences(dev, 1, &imagesInFlight[nextFrame], VK_FALSE, UINT64_MAX);
+	if (imageSerials[nextFrame] != 0) {
+		waitForFrame(imageSerials[nextFrame]);
+		gpuTimes.collect(nextFrame);
 	}
 
-	imagesInFlight[nextFrame] = inFlightFences[currFrame]; // this frame is using the fence at currFrame
+	// time spent blocked on the presentation engine or the GPU after input was already sampled.
+	// input could have been sampled that much later, and the frame would still have gone out at the same time.
+	const double stall = std::chrono::duration<double, std::milli>(clock::now() - stallStart).count();
+	frameSlack.push(paceDelay + stall);
+
+	const uint64_t serial = submittedSerial + 1;
+	imageSerials[nextFrame] = serial; // this frame is using the image at nextFrame
 
-	updateUniformBuffer(nextFrame);
+	updateUniformBuffer(nextFrame, cam);
+	updateTrample(nextFrame, cam);
 
 	VkSubmitInfo si{};
 	si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
 	VkSemaphore renderBeginSems[] = { imageAvailSems[currFrame] };
-	VkSemaphore renderEndSems[] = { renderDoneSems[currFrame] };
+	VkSemaphore renderEndSems[] = { renderDoneSems[currFrame], frameTimeline };
+
+	// values for binary semaphores are ignored, but every semaphore needs an entry
+	uint64_t waitValues[] = { 0 };
+	uint64_t signalValues[] = { 0, serial };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = 1;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = 2;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+	si.pNext = &timelineInfo;
 
 	si.waitSemaphoreCount = 1;
 	si.pWaitSemaphores = renderBeginSems;
@@ -185,16 +517,18 @@ void appvk::drawFrame() {
 	si.commandBufferCount = 1;
 	si.pCommandBuffers = &commandBuffers[nextFrame];
 
-	si.signalSemaphoreCount = 1;
+	si.signalSemaphoreCount = 2;
 	si.pSignalSemaphores = renderEndSems;
 
-	vkResetFences(dev, 1, &inFlightFences[currFrame]); // has to be unsignaled for vkQueueSubmit
-	vkQueueSubmit(gQueue, 1, &si, inFlightFences[currFrame]);
+	vkQueueSubmit(gQueue, 1, &si, VK_NULL_HANDLE);
+	submittedSerial = serial;
+	frameSerials[currFrame] = serial;
+	inputLatency.push(std::chrono::duration<double, std::milli>(clock::now() - inputTime).count());
 
 	VkPresentInfoKHR pInfo{};
 	pInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	pInfo.waitSemaphoreCount = 1;
-	pInfo.pWaitSemaphores = renderEndSems;
+	pInfo.pWaitSemaphores = &renderDoneSems[currFrame];
 	pInfo.swapchainCount = 1;
 	pInfo.pSwapchains = &swap;
 	pInfo.pImageIndices = &nextFrame;
@@ -203,38 +537,227 @@ void appvk::drawFrame() {
 	if (r == VK_ERROR_OUT_OF_DATE_KHR || resizeOccurred) {
 		recreateSwapChain();
 		resizeOccurred = false;
-		return;
+		return false;
 	} else if (r != VK_SUCCESS && r != VK_SUBOPTIMAL_KHR) {
 		throw std::runtime_error("cannot submit to queue!");
 	}
 
 	currFrame = (currFrame + 1) % framesInFlight;
+	return true;
+}
+
+appvk::cameraState appvk::interpolate(const cameraState& a, const cameraState& b, double alpha) {
+	const float t = alpha;
+	cameraState r;
+	r.pos = glm::mix(a.pos, b.pos, t);
+	r.front = glm::mix(a.front, b.front, t);
+
+	const float len = glm::length(r.front);
+	r.front = len > 1e-6f ? r.front / len : b.front; // opposite directions mix to zero
+	return r;
+}
+
+void appvk::startSimulation() {
+	lastTick = clock::now();
+	currCam = cameraState{c.pos, c.front};
+	prevCam = currCam;
+}
+
+// run as many simulation ticks as have passed since the last one
+void appvk::simulate(clock::time_point now) {
+	const auto tick = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(tickSeconds));
+
+	if (now - lastTick > tick * maxCatchUpTicks) {
+		lastTick = now - tick * maxCatchUpTicks;
+	}
+
+	while (now - lastTick >= tick) {
+		lastTick += tick;
+		prevCam = currCam;
+		c.update(w);
+		currCam = cameraState{c.pos, c.front};
+	}
+}
+
+// reads window state and input, only on the main thread since that owns glfw and the camera
+appvk::frameInput appvk::sampleInput() {
+	frameInput in;
+	in.sampled = clock::now();
+
+	if (glfwGetKey(w, GLFW_KEY_I) == GLFW_PRESS) {
+		std::cout << "\tcamera position: (" << c.pos.x << ", " << c.pos.y << ", " << c.pos.z << ")\n";
+	}
+	in.printMemory = glfwGetKey(w, GLFW_KEY_M) == GLFW_PRESS;
+	in.printFrameTimes = glfwGetKey(w, GLFW_KEY_L) == GLFW_PRESS;
+
+	// count presses rather than sending the key state, so a press isn't lost if the renderer skips this input
+	const bool qualityKey = glfwGetKey(w, GLFW_KEY_Q) == GLFW_PRESS;
+	if (qualityKey && !qualityKeyDown) {
+		qualityPresses++;
+	}
+	qualityKeyDown = qualityKey;
+	in.qualityPresses = qualityPresses;
+
+	const bool windKey = glfwGetKey(w, GLFW_KEY_B) == GLFW_PRESS;
+	if (windKey && !windKeyDown) {
+		windPresses++;
+	}
+	windKeyDown = windKey;
+	in.windPresses = windPresses;
+
+	simulate(in.sampled);
+	in.tickTime = lastTick;
+	in.prevCam = prevCam;
+	in.currCam = currCam;
+
+	glfwGetFramebufferSize(w, &in.fbWidth, &in.fbHeight);
+
+	if (glfwGetKey(w, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+		glfwSetWindowShouldClose(w, GLFW_TRUE);
+	}
+
+	return in;
+}
+
+bool appvk::renderFrame(const frameInput& in) {
+	if (in.printMemory) {
+		mtrack.report(cout);
+	}
+	if (in.printFrameTimes) {
+		reportFrameTimes();
+	}
+	if ((in.qualityPresses - qualityPressesApplied) % 2 != 0) {
+		setQuality(quality == options::quality::high ? options::quality::low : options::quality::high);
+	}
+	qualityPressesApplied = in.qualityPresses;
+	if ((in.windPresses - windPressesApplied) % 2 != 0) {
+		setWind(!windOn);
+	}
+	windPressesApplied = in.windPresses;
+	if (shaderWatch.watching()) {
+		reloadShaders();
+	}
+
+	inputTime = in.sampled;
+	fbWidth = in.fbWidth;
+	fbHeight = in.fbHeight;
+
+	// currCam is the newest tick, so this frame shows the state between the last two ticks
+	const double alpha = std::chrono::duration<double>(clock::now() - in.tickTime).count() / tickSeconds;
+	const cameraState cam = interpolate(in.prevCam, in.currCam, std::clamp(alpha, 0.0, 1.0));
+
+	const viewState view{cam, swapExtent};
+	// wind changes every frame, and so does trampled grass until it is back up
+	if (settings.onDemand && !windOn && !trampleRecovering && !resizeOccurred && view == drawnView) {
+		return false;
+	}
+
+	if (drawFrame(cam)) {
+		drawnView = view;
+	}
+	return true;
 }
 
 void appvk::run() {
+	if (settings.precisionCheck) {
+		if (!checkPrecision()) {
+			throw std::runtime_error(std::string(precisionName(precision)) + " shading differs visibly from fp32!");
+		}
+		return;
+	}
+	if (settings.renderThread) {
+		runThreaded();
+		return;
+	}
+
+	bool idle = false;
+	startSimulation();
+
 	while (!glfwWindowShouldClose(w)) {
-		glfwPollEvents();
-		if (glfwGetKey(w, GLFW_KEY_I) == GLFW_PRESS) {
-			std::cout << "\tcamera position: (" << c.pos.x << ", " << c.pos.y << ", " << c.pos.z << ")\n";
+		atrack::beginFrame();
+
+		if (idle) {
+			// the last presented image is still correct, so sleep until something happens
+			glfwWaitEventsTimeout(idleWaitSeconds);
+			waitForFrame(frameSerials[currFrame]); // long done by now, but paceFrame() didn't run
+
+			// nothing moved while idle, so don't simulate the time spent asleep with whatever input woke us up
+			lastTick = std::max(lastTick, clock::now() - std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(tickSeconds)));
+		} else {
+			paceFrame();
+			glfwPollEvents();
 		}
-		c.update(w);
-		drawFrame();
 
-		if (glfwGetKey(w, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-			glfwSetWindowShouldClose(w, GLFW_TRUE);
+		idle = !renderFrame(sampleInput());
+
+		atrack::endFrame();
+	}
+
+	vkDeviceWaitIdle(dev);
+}
+
+// the main thread keeps glfw and the camera and samples input once per tick,
+// a render thread draws and presents with whatever input is newest.
+// a slow present or a window manager hiccup in glfwPollEvents only stalls its own thread.
+void appvk::runThreaded() {
+	std::exception_ptr renderError;
+	std::atomic<bool> renderDone = false;
+
+	startSimulation();
+	inputs.publish(sampleInput()); // so the renderer has something to start with
+	std::thread render([&] {
+		try {
+			renderLoop();
+		} catch (...) {
+			renderError = std::current_exception();
 		}
+		renderDone = true;
+	});
+
+	const auto tick = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(tickSeconds));
+
+	while (!glfwWindowShouldClose(w) && !renderDone) {
+		glfwPollEvents();
+		inputs.publish(sampleInput());
+
+		std::this_thread::sleep_until(lastTick + tick); // wake up for the next simulation tick
 	}
 
+	stopRender = true;
+	render.join();
+
 	vkDeviceWaitIdle(dev);
+
+	if (renderError) {
+		std::rethrow_exception(renderError);
+	}
+}
+
+void appvk::renderLoop() {
+	inputs.consume(latestInput);
+
+	while (!stopRender) {
+		atrack::beginFrame();
+
+		paceFrame();
+		inputs.consume(latestInput); // keeps the previous input if the main thread hasn't published since
+
+		if (!renderFrame(latestInput)) {
+			// nothing new to draw, check back after the main thread's next tick
+			std::this_thread::sleep_for(std::chrono::duration<double>(tickSeconds));
+		}
+
+		atrack::endFrame();
+	}
 }
 
 int main(int argc, char **argv) {
-	(void)argc;
-	(void)argv;
+	const options::runtime settings = options::parse(argc, argv);
 
-	appvk app;
+	appvk app(settings);
 	try {
 		app.run();
+		atrack::report();
 	} catch (const std::exception& e) {
 		cerr << e.what() << "\n";
 		return 1;
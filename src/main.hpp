@@ -6,10 +6,24 @@
 #include <optional> // C++17, for device queue querying
 #include <utility> // for std::pair
 #include <tuple>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 
 #include "vformat.hpp"
 
+#include "options.hpp"
 #include "glm_mat_wrapper.hpp"
+#include "memtrack.hpp"
+#include "deferred.hpp"
+#include "profiler.hpp"
+#include "triple_buffer.hpp"
+#include "jobs.hpp"
+#include "pack.hpp"
+#include "shader_registry.hpp"
+#include "shader_compiler.hpp"
+#include "dir_watch.hpp"
 #include "camera.hpp"
 #include "terrain.hpp"
 
@@ -19,13 +33,19 @@ using std::cerr;
 class appvk {
 public:
 
-	appvk();
+	appvk(const options::runtime& settings);
 	~appvk();
 
 	void run();
 
 private:
 
+	const options::runtime settings;
+
+	jobs::pool workers; // cpu-side work that doesn't need vulkan (asset decoding, generation)
+
+	pack::archive assetPack; // baked assets from settings.packPath, anything missing from it loads from source
+
 	constexpr static unsigned int screenWidth = 3840;
 	constexpr static unsigned int screenHeight = 2160;
 
@@ -40,7 +60,7 @@ private:
 	
 	GLFWwindow* w;
 	
-	bool resizeOccurred = false;
+	std::atomic<bool> resizeOccurred = false; // set by glfw on the main thread, cleared by the renderer
 
 	VkSurfaceKHR surf = VK_NULL_HANDLE;
 
@@ -74,6 +94,11 @@ private:
 		VK_KHR_PIPELINE_EXECUTABLE_PROPERTIES_EXTENSION_NAME,
 	};
 
+	// enabled if the device has them, checked individually afterwards
+	constexpr static std::array<const char*, 1> optionalExtensions = {
+		VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+	};
+
     enum manufacturer { nvidia, intel, any };
 
     bool checkDeviceExtensions(VkPhysicalDevice pdev);
@@ -97,10 +122,13 @@ private:
     swapChainSupportDetails querySwapChainSupport(VkPhysicalDevice pdev);
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formatList);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& modeList);
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR; // what the current swapchain actually uses
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& cap);
+	int fbWidth = 0, fbHeight = 0; // framebuffer size as of the last input sample
 	
 	VkDevice dev = VK_NULL_HANDLE;
 	VkQueue gQueue = VK_NULL_HANDLE;
+	bool memoryBudget = false; // VK_EXT_memory_budget enabled
     void createLogicalDevice();
 	
 	VkSwapchainKHR swap = VK_NULL_HANDLE;
@@ -113,6 +141,7 @@ private:
     void createSwapViews();
 
     VkFormat findImageFormat(const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags features);
+	bool linearImageSupported(VkFormat format, VkImageUsageFlags usage, VkImageCreateFlags flags, unsigned int layers);
     VkImageView createImageView(VkImage im, VkFormat format, unsigned int mipLevels, VkImageAspectFlags aspectMask);
 	
 	VkRenderPass renderPass = VK_NULL_HANDLE;
@@ -125,6 +154,10 @@ private:
 		alignas(16) glm::mat4 model;
 		alignas(16) glm::mat4 view;
 		alignas(16) glm::mat4 proj;
+		float time; // seconds since startup, drives the wind field
+		float windStrength; // 0 with wind off, scales the bend in the grass vertex shaders
+		alignas(16) glm::vec4 trampleBounds; // xz origin and size the trample field covers (the terrain's)
+		alignas(8) glm::uvec2 nearFirst; // first field grass cell drawn as blades, follows the camera (see grassFieldParams)
 	};
 
 	std::vector<VkBuffer> mvpBuffers;
@@ -132,6 +165,9 @@ private:
 	void createUniformBuffers();
 
     VkDescriptorSetLayout dSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout grassSetLayout = VK_NULL_HANDLE; // dSetLayout plus the heightmap, wind and trample fields and the impostor atlas
+	VkDescriptorSetLayout windSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout trampleSetLayout = VK_NULL_HANDLE;
 	VkDescriptorSetLayout skySetLayout = VK_NULL_HANDLE;
     void createDescriptorSetLayouts();
 
@@ -142,21 +178,70 @@ private:
     std::vector<VkDescriptorSet> terrainSet;
 	std::vector<VkDescriptorSet> grassSet;
 	std::vector<VkDescriptorSet> skySet;
+	std::vector<VkDescriptorSet> windSet;
+	std::vector<VkDescriptorSet> trampleSet;
 	void allocDescriptorSets(VkDescriptorPool pool, std::vector<VkDescriptorSet>& dSet, VkDescriptorSetLayout layout);
     void allocDescriptorSetUniform(std::vector<VkDescriptorSet>& dSet);
-	void allocDescriptorSetTexture(std::vector<VkDescriptorSet>& dSet, VkSampler samp, VkImageView view);
-
-	std::vector<char> readFile(std::string_view path);
-    VkShaderModule createShaderModule(const std::vector<char>& spv);
+	void allocDescriptorSetTexture(std::vector<VkDescriptorSet>& dSet, VkSampler samp, VkImageView view, uint32_t binding = 1);
+	void allocDescriptorSetWind(); // the field image in windSet and grassSet
+	void allocDescriptorSetTrample(); // the field image and per image buffers in trampleSet, the field in grassSet
+
+	vkr::shaderRegistry shaders; // modules outlive pipelines, so rebuilding one doesn't touch the filesystem
+	VkShaderModule loadShaderModule(std::string_view path); // loaded on first use, from the pack if it has it
+	VkShaderModule readShaderModule(std::string_view path); // from disk, for reloads
+	glsl::compiler glslc; // only does anything in "make live" builds, see shader_compiler.hpp
+
+	io::dirWatcher shaderWatch; // with --watch-shaders, polled once per frame on the rendering thread
+	io::dirWatcher includeWatch; // shader/include, only in "make live" builds (the shader makefile tracks includes otherwise)
+	void reloadShaders();
 	
-	VkPipelineLayout terrainPipeLayout = VK_NULL_HANDLE;
-	VkPipeline terrainPipe = VK_NULL_HANDLE;
+	vkr::pipelineLayout terrainPipeLayout;
+	vkr::pipelineLayout grassPipeLayout; // grassSetLayout and the field parameters as push constants
+	vkr::pipelineLayout skyPipeLayout;
+	vkr::pipeline skyPipe;
+
+	// lighting and alpha test parameters, compiled into the terrain and grass fragment shaders as specialization
+	// constants (ids in declaration order, see shader/*.frag), so each tier is constant folded instead of branching
+	struct shadingConstants {
+		glm::vec3 lightPos;
+		glm::vec3 lightColor;
+		glm::vec3 falloff; // constant, linear and quadratic attenuation
+		float alphaCutoff; // grass texels with alpha at or below this are discarded
+		VkBool32 diffuse; // per-pixel diffuse term, otherwise the light's average contribution
+	};
+	static_assert(sizeof(shadingConstants) == 11 * sizeof(float), "shading constants are hashed, so they can't have padding");
+	static shadingConstants shadingFor(options::quality q);
+
+	// arithmetic precision of the terrain and grass color math, each one is its own build of the fragment shaders
+	// (.spv/<name>.frag[.f16|.relaxed].spv, see shader/makefile). half needs shaderFloat16, relaxed is the fallback:
+	// mediump only allows the driver to lower precision, so it may run exactly like full.
+	enum class fragPrecision : uint32_t { full, half, relaxed };
+	fragPrecision precision = fragPrecision::full; // decided in createLogicalDevice
+	bool float16 = false; // shaderFloat16 enabled
+	static const char* precisionSuffix(fragPrecision p);
+	static const char* precisionName(fragPrecision p);
+
+	// pipelines per set of shading constants, only tiers that get used are built. cleared with the swapchain.
+	struct shadedPipelines {
+		vkr::pipeline terrain;
+		vkr::pipeline grass;
+		vkr::pipeline impostor; // only with impostors
+	};
+	std::unordered_map<uint64_t, shadedPipelines> shadedVariants; // by hash of the constants and precision
+	VkPipeline terrainPipe = VK_NULL_HANDLE; // the current tier's, owned by shadedVariants
+	VkPipeline grassPipe = VK_NULL_HANDLE;
+	VkPipeline impostorPipe = VK_NULL_HANDLE;
 
-	VkPipelineLayout skyPipeLayout = VK_NULL_HANDLE;
-	VkPipeline skyPipe = VK_NULL_HANDLE;
+	options::quality quality; // current tier, starts out as settings.shading
+	unsigned int qualityPressesApplied = 0;
+	void setQuality(options::quality q);
+	void rerecordRenderCmdBuffers();
 
-	VkPipeline grassPipe = VK_NULL_HANDLE;
-	void createGraphicsPipeline();
+	void createGraphicsPipeline(); // builds whatever the current settings need that doesn't exist yet
+
+	VkPipelineCache pipeCache = VK_NULL_HANDLE; // shared by every pipeline compile, kept across swapchain recreation
+	void createPipelineCache();
+	void createPipelines(const std::vector<VkGraphicsPipelineCreateInfo>& infos, const std::vector<vkr::pipeline*>& out);
 
 	bool printed = false;
     void printShaderStats();
@@ -167,18 +252,48 @@ private:
 	VkCommandPool cp = VK_NULL_HANDLE;
 	void createCommandPool();
 	
-	uint32_t findMemoryType(uint32_t legalMemoryTypes, VkMemoryPropertyFlags properties);
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkBuffer& buf, VkDeviceMemory& bufMem);
+	mem::tracker mtrack; // every device allocation goes through here
+	VkPhysicalDeviceMemoryProperties memProps{};
+	bool uma = false; // integrated or software device, all memory is host memory
+	VkDeviceSize directHeapSize = 0; // largest heap that is both device-local and host-visible (UMA or resizable BAR)
+	bool directUpload = false; // write static data straight into device-local memory, no staging copy
+	constexpr static VkMemoryPropertyFlags directMemory = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	void cacheMemoryProperties();
+	std::optional<uint32_t> pickMemoryType(uint32_t legalMemoryTypes, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkMemoryPropertyFlags avoided, VkDeviceSize size);
+	uint32_t findMemoryType(uint32_t legalMemoryTypes, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkMemoryPropertyFlags avoided, VkDeviceSize size);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, mem::category cat, VkBuffer& buf, VkDeviceMemory& bufMem);
+	void allocateMemory(const VkMemoryRequirements& mreq, VkMemoryPropertyFlags props, mem::category cat, VkDeviceMemory& m);
+	void allocateMemory(const VkMemoryRequirements& mreq, uint32_t typeIndex, mem::category cat, VkDeviceMemory& m);
+	void freeMemory(VkDeviceMemory m);
+
+	// resources handed to retire() are destroyed once every frame that might still use them has completed,
+	// so they can be replaced while rendering continues instead of waiting for the device to go idle.
+	vkr::deletionQueue deletions;
+	uint64_t submittedSerial = 0; // serial of the last frame submitted, also the value it signals on frameTimeline
+	std::vector<uint64_t> frameSerials; // serial last submitted from each frame-in-flight slot
+
+	template <typename T, auto destroyFn>
+	void retire(vkr::unique<T, destroyFn>&& h) {
+		deletions.push(submittedSerial, std::move(h));
+	}
 
     VkCommandBuffer beginSingleCommand();
     void endSingleCommand(VkCommandBuffer buf);
 
-	void createImage(unsigned int width, unsigned int height, VkFormat format, unsigned int mipLevels, VkSampleCountFlagBits samples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, VkImage& image, VkDeviceMemory& imageMemory);
-	void createCubeImage(unsigned int width, unsigned int height, VkFormat format, VkSampleCountFlagBits samples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, VkImage& image, VkDeviceMemory& imageMemory);
+	VkCommandBuffer uploadCmd = VK_NULL_HANDLE; // open upload batch, if any
+	std::vector<std::pair<VkBuffer, VkDeviceMemory>> pendingStaging; // freed when the batch completes
+	void beginUploadBatch();
+	void submitUploadBatch();
+	void discardUploadBatch();
+	void releaseStaging(VkBuffer buf, VkDeviceMemory m);
+
+	void createImage(unsigned int width, unsigned int height, VkFormat format, unsigned int mipLevels, VkSampleCountFlagBits samples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, mem::category cat, VkImage& image, VkDeviceMemory& imageMemory);
+	void createCubeImage(unsigned int width, unsigned int height, VkFormat format, VkSampleCountFlagBits samples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, mem::category cat, VkImage& image, VkDeviceMemory& imageMemory);
     VkImageView createCubeImageView(VkImage im, VkFormat format);
 	void transitionImageLayout(VkImage image, VkImageLayout oldl, VkImageLayout newl, unsigned int mipLevels, unsigned int layers);
     
     void copyBufferToImage(VkBuffer buf, VkImage img, uint32_t width, uint32_t height, uint32_t layers);
+	void copyMipsToImage(VkBuffer buf, VkImage img, const pack::entry& e);
     void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size);
 
 	VkBuffer terrainVertBuf = VK_NULL_HANDLE;
@@ -190,14 +305,140 @@ private:
 	VkBuffer skyVertBuf = VK_NULL_HANDLE;
 	VkDeviceMemory skyVertMem = VK_NULL_HANDLE;
 
+	// grass is scattered over the terrain by a compute shader at load time (see scatterGrass). each terrain triangle
+	// gets settings.grassPerTriangle candidate spots, kept with the probability the density map gives there.
+	// kept instances (vec4, position and yaw) go into grassVertInstBuf and are counted into grassDrawBuf,
+	// an indirect draw command, so the CPU never generates or even sees them.
 	VkBuffer grassVertInstBuf = VK_NULL_HANDLE;
 	VkDeviceMemory grassVertInstMem = VK_NULL_HANDLE;
-    std::pair<VkBuffer, VkDeviceMemory> createVertexBuffer(std::vector<vformat::vertex>& v);
-	std::pair<VkBuffer, VkDeviceMemory> createVertexBuffer(const std::vector<uint8_t>& verts);
+	VkBuffer grassDrawBuf = VK_NULL_HANDLE;
+	VkDeviceMemory grassDrawMem = VK_NULL_HANDLE;
+	uint32_t grassCandidates = 0; // most instances there can be
+
+	// with --grass-clump=K each instance is K blades instead of the grass model. grassclump.vert makes up every
+	// vertex from gl_VertexIndex (blade = index / clumpBladeVertices), so the only buffer is this index pattern,
+	// the same quads for every clump. there are K times fewer instances for the same number of blades.
+	constexpr static uint32_t clumpBladeVertices = 6; // 2 wide, 3 rows high so the blade can bend
+	constexpr static uint32_t clumpBladeIndices = 12;
+	VkBuffer clumpIndBuf = VK_NULL_HANDLE;
+	VkDeviceMemory clumpIndMem = VK_NULL_HANDLE;
+	uint32_t clumpIndices = 0;
+	void createClumpIndexBuffer();
+	void scatterGrass(VkImageView density, VkSampler densitySamp);
+
+	// with --grass=field there is no instance data at all. grassfield.vert puts instance N in cell N of a
+	// cells x cells grid over the terrain, hashes N for the jitter, yaw and scale of the blade and reads the
+	// ground height from heightImage, so grass memory stays the same however many blades are drawn.
+	// with impostors only a nearSide x nearSide window of cells around the camera is drawn as blades (it starts at
+	// mvp::nearFirst), every cardCells x cardCells block of cells not wholly inside it is one impostor card.
+	struct grassFieldParams {
+		glm::vec2 origin;
+		glm::vec2 size;
+		uint32_t cells;
+		uint32_t seed;
+		uint32_t cardCells; // cells per side of an impostor card
+		uint32_t nearSide; // cells per side drawn as blades, all of them without impostors
+	};
+	grassFieldParams grassField{};
+
+	// far field grass is drawn as camera facing cards, one per block of field cells, textured from an atlas that
+	// bakeImpostors() renders at load time: the grass of one block seen from impostorAzimuths directions around it at
+	// impostorElevations heights, color in one image and normal and coverage in the other. impostor.vert picks the
+	// baked view closest to the direction the card is seen from, so the far field costs 6 vertices and a few
+	// alpha tested texels per block instead of a blade per cell. see shader/impostorbake.* and shader/impostor.*.
+	constexpr static uint32_t impostorAzimuths = 8;
+	constexpr static uint32_t impostorElevations = 3; // 0, 30 and 60 degrees
+	constexpr static uint32_t impostorTexels = 128; // per side of a view in the atlas, a power of two so no mip mixes views
+	constexpr static float impostorCardSize = 2.0f; // world units a card roughly covers, rounded to whole cells
+	constexpr static float impostorCardHeight = 0.5f * 1.25f; // the tallest blade grassfield.vert makes from the 0.5 high grass model
+	struct impostorConstants {
+		uint32_t azimuths;
+		uint32_t elevations;
+		float cardHeight;
+	};
+	VkSpecializationInfo impostorSpecInfo() const; // the atlas layout for shader/include/impostor.glsl, points at static data
+	const bool impostors = settings.grassMode == options::grass::field && settings.impostorDistance > 0;
+	VkImage impostorColorImage = VK_NULL_HANDLE;
+	VkDeviceMemory impostorColorMem = VK_NULL_HANDLE;
+	VkImageView impostorColorView = VK_NULL_HANDLE;
+	VkImage impostorNormalImage = VK_NULL_HANDLE;
+	VkDeviceMemory impostorNormalMem = VK_NULL_HANDLE;
+	VkImageView impostorNormalView = VK_NULL_HANDLE;
+	VkSampler impostorSamp = VK_NULL_HANDLE;
+	void bakeImpostors(); // needs the grass model, the grass texture in grassSet[0] and grassField
+	constexpr static uint32_t heightmapSize = 256; // texels per side, over the terrain's xz bounds
+	VkImage heightImage = VK_NULL_HANDLE;
+	VkDeviceMemory heightMem = VK_NULL_HANDLE;
+	VkImageView heightView = VK_NULL_HANDLE;
+	VkSampler heightSamp = VK_NULL_HANDLE;
+	std::vector<uint16_t> sampleHeightmap(); // fp16 heights, row-major from terrainOrigin
+	std::tuple<VkImage, VkDeviceMemory> createHeightmapImage(const std::vector<uint16_t>& heights);
+
+	// wind is a small rgba16f field (xy bend, z gust) over the world's xz plane, rewritten every frame by
+	// wind.comp from mvp::time before the render pass, so its cost doesn't depend on the amount of grass.
+	// the grass vertex shaders sample it to push blade tips around. B toggles it.
+	constexpr static uint32_t windSize = 64; // texels per side
+	VkImage windImage = VK_NULL_HANDLE;
+	VkDeviceMemory windMem = VK_NULL_HANDLE;
+	VkImageView windView = VK_NULL_HANDLE;
+	VkSampler windSamp = VK_NULL_HANDLE;
+	vkr::pipelineLayout windPipeLayout;
+	vkr::pipeline windPipe;
+	bool windOn; // from settings, then B
+	unsigned int windPressesApplied = 0;
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	uint32_t windZone;
+	void createWind();
+	void recordWind(VkCommandBuffer cbuf, size_t i);
+	void setWind(bool on);
+
+	// anything in the grass (for now the camera, when it is down on the ground) flattens it. every frame each contact
+	// is stamped into trampleImage, a persistent rgba16f field over the terrain (xy push direction scaled by z, z how
+	// flat), as a rect of texels around it, and tiles with anything still flat in them recover a little. both passes
+	// are indirect dispatches sized per frame in trampleBufs, so GPU work follows the contact area, not the field size.
+	// see shader/trample.comp and shader/recover.comp.
+	constexpr static uint32_t trampleSize = 256; // texels per side
+	constexpr static uint32_t trampleTile = 8; // texels per side of a recovery tile, the recover.comp workgroup size
+	constexpr static uint32_t trampleTiles = trampleSize / trampleTile;
+	constexpr static uint32_t maxContacts = 256; // per frame, the array size in the shaders
+	constexpr static float trampleRecoverySeconds = 6.0f; // from flat to upright
+	struct trampleContact {
+		glm::vec4 shape; // xy center on the xz plane, z radius, w strength
+		int32_t rect[4]; // texels covered, first x and y, then width and height
+	};
+	// std430, as declared in both shaders
+	struct trampleFrame {
+		VkDispatchIndirectCommand stamp; // a row of workgroups per contact
+		VkDispatchIndirectCommand recover; // a workgroup per tile that is still recovering
+		float recovered; // flatness regained since the last frame
+		uint32_t contacts;
+		alignas(16) glm::vec4 bounds; // same as mvp::trampleBounds
+		trampleContact contact[maxContacts];
+		uint32_t tiles[trampleTiles * trampleTiles][2];
+	};
+	std::vector<VkBuffer> trampleBufs; // per swapchain image, like the uniform buffers
+	std::vector<VkDeviceMemory> trampleMems;
+	VkImage trampleImage = VK_NULL_HANDLE;
+	VkDeviceMemory trampleMem = VK_NULL_HANDLE;
+	VkImageView trampleView = VK_NULL_HANDLE;
+	VkSampler trampleSamp = VK_NULL_HANDLE;
+	vkr::pipelineLayout tramplePipeLayout;
+	vkr::pipeline stampPipe;
+	vkr::pipeline recoverPipe;
+	std::vector<float> tileRecovery; // seconds until each tile is upright again, 0 for untouched
+	std::vector<uint32_t> activeTiles; // indices of the tiles with tileRecovery above 0, in no particular order
+	std::chrono::steady_clock::time_point lastTrample{};
+	bool trampleRecovering = false; // some tile is, so on-demand rendering can't stop yet
+	uint32_t trampleZone;
+	void createTrample();
+	void recordTrample(VkCommandBuffer cbuf, size_t i);
+	vkr::pipeline createComputePipeline(std::string_view shader, VkPipelineLayout layout);
+	std::pair<VkBuffer, VkDeviceMemory> createUploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, mem::category cat);
+    std::pair<VkBuffer, VkDeviceMemory> createVertexBuffer(const std::vector<vformat::vertex>& v);
+	std::pair<VkBuffer, VkDeviceMemory> createVertexBuffer(const void* verts, VkDeviceSize size, mem::category cat);
 
 	VkBuffer terrainIndBuf = VK_NULL_HANDLE;
 	VkDeviceMemory terrainIndMem = VK_NULL_HANDLE;
-    std::pair<VkBuffer, VkDeviceMemory> createIndexBuffer(const std::vector<uint32_t>& indices);
 
 	VkImage terrainImage = VK_NULL_HANDLE;
 	VkDeviceMemory terrainMem = VK_NULL_HANDLE;
@@ -215,8 +456,17 @@ private:
 	VkDeviceMemory cubeMem = VK_NULL_HANDLE;
     VkImageView cubeView = VK_NULL_HANDLE;
 	VkSampler cubeSamp = VK_NULL_HANDLE;
-	std::tuple<VkImage, VkDeviceMemory, unsigned int> createTextureImage(std::string_view path, bool flip);
-	std::tuple<VkImage, VkDeviceMemory> createCubemapImage(std::array<std::string_view, 6> paths, bool flip);
+
+	// rgba8 pixels decoded on a worker thread, uploaded later on the main thread
+	struct decodedImage {
+		using pixelPtr = std::unique_ptr<unsigned char, void(*)(void*)>;
+		pixelPtr pixels{nullptr, nullptr};
+		int width = 0, height = 0;
+	};
+	static decodedImage decodeImage(std::string_view path, bool flip);
+	std::tuple<VkImage, VkDeviceMemory, unsigned int> createTextureImage(const decodedImage& img, VkFormat format);
+	std::tuple<VkImage, VkDeviceMemory> createCubemapImage(const std::array<decodedImage, 6>& faces);
+	std::tuple<VkImage, VkDeviceMemory, unsigned int> createPackedImage(const pack::entry& e); // mips are already in the pack
 
     VkSampler createSampler(unsigned int mipLevels);
 	VkSampler createCubeSampler();
@@ -236,34 +486,108 @@ private:
 	
 	uint32_t terrainIndices;
 	uint32_t grassVertices;
-	uint32_t grassInstances;
 	uint32_t grassIndices;
 	uint32_t skyVertices;
 	void allocRenderCmdBuffers();
+	void recordScene(VkCommandBuffer cbuf, size_t i, VkFramebuffer fb); // the render pass, with image i's descriptor sets
+
+	prof::gpuTimer gpuTimes; // timestamps recorded into the render command buffers
+	uint32_t frameZone; // the whole render pass
 
-	constexpr static unsigned int framesInFlight = 2;
+	const unsigned int framesInFlight; // from settings, 1-4
 
 	// swapchain image acquisition requires a binary semaphore since it might be hard for implementations to do timeline semaphores
 	std::vector<VkSemaphore> imageAvailSems; // use seperate semaphores per frame so we can send >1 frame at once
-	std::vector<VkSemaphore> renderDoneSems;
-	std::vector<VkFence> inFlightFences; // use fences so we actually wait until a frame completes before moving on to the next one
-	std::vector<VkFence> imagesInFlight; // track frames in flight because acquireNextImageKHR may not return swapchain indices in order
+	std::vector<VkSemaphore> renderDoneSems; // presentation can only wait on binary semaphores as well
+	VkSemaphore frameTimeline = VK_NULL_HANDLE; // frame N signals value N when the GPU is done with it
+	std::vector<uint64_t> imageSerials; // track frames in flight because acquireNextImageKHR may not return swapchain indices in order
     void createSyncs();
+	void waitForFrame(uint64_t serial);
+	uint64_t completedSerial();
 
     void recreateSwapChain();
+	bool waitForWindow();
+
+	// latency measurements and low latency pacing, see paceFrame()
+	using clock = std::chrono::steady_clock;
+	clock::time_point inputTime; // when input for the frame being built was sampled
+	double paceDelay = 0.0; // ms slept before sampling input for the frame being built
+	clock::time_point lastFrameStart; // for the max-fps cap
+	prof::history inputLatency; // input sampling to queue submission, ms
+	prof::history frameSlack; // how much later each frame could have sampled input without being shown any later, ms
+	void paceFrame();
+	void reportFrameTimes();
 
 	// this scene is set up so that the camera is in -Z looking towards +Z.
     cam::camera c;
 	ter::terrain t;
-
-	std::vector<glm::mat4> grassMatBuf;
-	void initGrass(const std::vector<vformat::vertex>& verts, const std::vector<uint32_t>& indices);
-	
-    void updateUniformBuffer(uint32_t imageIndex);
+	glm::vec2 terrainOrigin{}, terrainSize{}; // xz bounds of t, set right after it is generated
 
 	size_t currFrame = 0;
 
-	void drawFrame();
+	// the part of the camera the renderer needs, copied out so rendering never touches the camera itself
+	struct cameraState {
+		glm::vec3 pos;
+		glm::vec3 front;
+	};
+
+	// everything updateUniformBuffer() reads, so on-demand rendering can tell whether a new frame would look any different
+	struct viewState {
+		cameraState cam;
+		VkExtent2D extent;
+
+		bool operator==(const viewState& o) const {
+			return cam.pos == o.cam.pos && cam.front == o.cam.front && extent.width == o.extent.width && extent.height == o.extent.height;
+		}
+	};
+	viewState drawnView{}; // what the last presented frame showed
+	constexpr static double idleWaitSeconds = 0.25; // wake up now and then while idle, even without events
+
+	static cameraState interpolate(const cameraState& a, const cameraState& b, double alpha);
+
+	// the camera (and anything else simulated) moves in fixed ticks, so its speed doesn't depend on the frame rate.
+	// frames interpolate between the last two ticks, which puts rendering one tick behind the simulation.
+	const double tickSeconds; // from settings
+	constexpr static unsigned int maxCatchUpTicks = 8; // after a long stall, drop time instead of simulating it all at once
+	clock::time_point lastTick;
+	cameraState prevCam{}, currCam{};
+	void startSimulation();
+	void simulate(clock::time_point now);
+
+	// everything the main thread (which owns glfw and the camera) hands to the renderer
+	struct frameInput {
+		clock::time_point sampled;
+		clock::time_point tickTime; // when currCam was simulated
+		cameraState prevCam, currCam;
+		int fbWidth = 0, fbHeight = 0; // glfw only answers this on the main thread
+		bool printMemory = false;
+		bool printFrameTimes = false;
+		unsigned int qualityPresses = 0; // Q presses so far, the renderer switches tier on every new one
+		unsigned int windPresses = 0; // B, same idea
+	};
+	bool qualityKeyDown = false; // main thread only, for counting presses
+	unsigned int qualityPresses = 0;
+	bool windKeyDown = false;
+	unsigned int windPresses = 0;
+	frameInput sampleInput();
+	bool renderFrame(const frameInput& in); // false if on-demand rendering had nothing new to draw
+
+	// with a render thread, the main thread publishes input once per tick and the renderer picks up the latest
+	spsc::tripleBuffer<frameInput> inputs;
+	frameInput latestInput;
+	std::atomic<bool> stopRender = false;
+	void runThreaded();
+	void renderLoop();
+
+	bool drawFrame(const cameraState& cam); // false if no frame was presented
+    void updateUniformBuffer(uint32_t imageIndex, const cameraState& cam);
+	void updateTrample(uint32_t imageIndex, const cameraState& cam); // contacts and recovering tiles for the frame
+
+	// checking reduced precision shading against full precision, with --precision-check
+	constexpr static unsigned int maxPrecisionError = 4; // per 8 bit channel
+	constexpr static double minPrecisionPsnr = 40.0; // dB
+	std::vector<uint8_t> captureFrame(const cameraState& cam);
+	bool checkPrecision();
 
     void cleanupSwapChain();
     void cleanup();
@@ -0,0 +1,110 @@
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+io::mappedFile::mappedFile(const std::string& path) {
+    if (!open(path)) {
+        throw std::runtime_error("cannot open file " + path + "!");
+    }
+}
+
+io::mappedFile::~mappedFile() {
+    close();
+}
+
+io::mappedFile::mappedFile(mappedFile&& o) noexcept {
+    *this = std::move(o);
+}
+
+io::mappedFile& io::mappedFile::operator=(mappedFile&& o) noexcept {
+    if (this != &o) {
+        close();
+        map = std::exchange(o.map, nullptr);
+        buffer = std::move(o.buffer);
+        length = std::exchange(o.length, 0);
+        mtime = std::exchange(o.mtime, 0);
+        opened = std::exchange(o.opened, false);
+        bytes = map ? static_cast<const uint8_t*>(map) : buffer.data();
+        o.bytes = nullptr;
+    }
+    return *this;
+}
+
+bool io::mappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    length = st.st_size;
+    mtime = st.st_mtime;
+
+    if (length > 0) {
+        void* m = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            map = m;
+        }
+    }
+
+    if (!map) {
+        // buffered read. the size can be wrong (pipes, procfs), so keep going until eof
+        buffer.resize(length);
+        size_t got = 0;
+        while (true) {
+            uint8_t chunk[4096];
+            const bool full = got == buffer.size();
+            ssize_t n = full ? read(fd, chunk, sizeof(chunk)) : read(fd, buffer.data() + got, buffer.size() - got);
+            if (n < 0) {
+                ::close(fd);
+                close();
+                return false;
+            }
+            if (n == 0) {
+                break;
+            }
+            if (full) {
+                buffer.insert(buffer.end(), chunk, chunk + n);
+            }
+            got += n;
+        }
+        buffer.resize(got);
+        length = got;
+    }
+
+    ::close(fd); // a mapping keeps the file alive on its own
+    bytes = map ? static_cast<const uint8_t*>(map) : buffer.data();
+    opened = true;
+    return true;
+}
+
+void io::mappedFile::close() {
+    if (map) {
+        munmap(map, length);
+    }
+    map = nullptr;
+    buffer.clear();
+    buffer.shrink_to_fit();
+    bytes = nullptr;
+    length = 0;
+    mtime = 0;
+    opened = false;
+}
+
+void io::mappedFile::prefetch() const {
+    if (map) {
+        madvise(map, length, MADV_WILLNEED);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace io {
+    // read-only view of a whole file. the file is memory mapped, so pages are only read in when touched
+    // and nothing is copied onto the heap. if mapping fails (empty files, filesystems without mmap support)
+    // the file is read into a buffer instead, the view looks the same either way.
+    class mappedFile {
+    public:
+        mappedFile() = default;
+        explicit mappedFile(const std::string& path); // throws if the file can't be read
+        ~mappedFile();
+
+        mappedFile(const mappedFile&) = delete;
+        mappedFile& operator=(const mappedFile&) = delete;
+
+        mappedFile(mappedFile&& o) noexcept;
+        mappedFile& operator=(mappedFile&& o) noexcept;
+
+        // false if the file doesn't exist or can't be read
+        bool open(const std::string& path);
+        void close();
+
+        bool isOpen() const { return opened; }
+        bool isMapped() const { return map != nullptr; }
+
+        const uint8_t* data() const { return bytes; }
+        size_t size() const { return length; }
+        const uint8_t* begin() const { return bytes; }
+        const uint8_t* end() const { return bytes + length; }
+
+        int64_t modified() const { return mtime; } // seconds since the epoch
+
+        // hint that the whole file is about to be read front to back
+        void prefetch() const;
+
+    private:
+        void* map = nullptr;
+        std::vector<uint8_t> buffer; // fallback when the file can't be mapped
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+        int64_t mtime = 0;
+        bool opened = false;
+    };
+}
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <string>
+
+#include "options.hpp"
+
 #include "main.hpp"
 
 void appvk::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) {
@@ -11,23 +16,104 @@ void appvk::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) {
     endSingleCommand(buf);
 }
 
-// find a memory type that our image or buffer can use and that has the properties we want
-uint32_t appvk::findMemoryType(uint32_t legalMemoryTypes, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProp{};
-    vkGetPhysicalDeviceMemoryProperties(pdev, &memProp);
+// memory types don't change, so grab them once instead of on every allocation
+void appvk::cacheMemoryProperties() {
+    vkGetPhysicalDeviceMemoryProperties(pdev, &memProps);
+
+    VkPhysicalDeviceProperties dprop;
+    vkGetPhysicalDeviceProperties(pdev, &dprop);
+
+    // integrated GPUs and software implementations (lavapipe) share memory with the host
+    uma = dprop.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || dprop.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
+        if ((memProps.memoryTypes[i].propertyFlags & directMemory) == directMemory) {
+            const VkDeviceSize heapSize = memProps.memoryHeaps[memProps.memoryTypes[i].heapIndex].size;
+            directHeapSize = std::max(directHeapSize, heapSize);
+        }
+    }
+
+    // without resizable BAR, discrete GPUs only expose a 256 MiB window of VRAM to the host.
+    // that's better kept for per-frame data than spent on static meshes.
+    const bool rebar = !uma && directHeapSize > 256 * 1024 * 1024;
+    directUpload = options::directUploads && directHeapSize > 0 && (uma || rebar);
+
+    if (directHeapSize > 0) {
+        cout << (uma ? "unified memory" : (rebar ? "resizable BAR" : "small BAR")) << ": "
+            << directHeapSize / (1024 * 1024) << " MiB of device-local memory is host-visible"
+            << (directUpload ? ", uploading without staging" : "") << "\n";
+    }
+}
+
+// find a memory type that our image or buffer can use and that has the properties we want.
+// every required flag has to be present; among those types, ones with more preferred flags
+// and fewer avoided flags win, then ones whose heap has the most room left.
+std::optional<uint32_t> appvk::pickMemoryType(uint32_t legalMemoryTypes, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkMemoryPropertyFlags avoided, VkDeviceSize size) {
+    std::optional<uint32_t> best;
+    int bestScore = 0;
+    VkDeviceSize bestRoom = 0;
 
     // turn a one-hot legalMemoryTypes into an int representing the index we want in memoryTypes
-    for (size_t i = 0; i < memProp.memoryTypeCount; i++) {
-        // if the type matches one of the allowed types given to us and it has the right flags, return it
-        if ((legalMemoryTypes & (1 << i)) && (memProp.memoryTypes[i].propertyFlags & properties)) {
-            return i;
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
+        const VkMemoryPropertyFlags flags = memProps.memoryTypes[i].propertyFlags;
+        if (!(legalMemoryTypes & (1 << i)) || (flags & required) != required) {
+            continue;
+        }
+
+        // skip heaps we've already filled, the driver would just fail or start paging
+        const uint32_t heap = memProps.memoryTypes[i].heapIndex;
+        const VkDeviceSize heapSize = memProps.memoryHeaps[heap].size;
+        const VkDeviceSize used = mtrack.heapUsage(heap).current;
+        const VkDeviceSize room = heapSize > used ? heapSize - used : 0;
+        if (room < size) {
+            continue;
+        }
+
+        const int score = __builtin_popcount(flags & preferred) - __builtin_popcount(flags & avoided);
+        if (!best || score > bestScore || (score == bestScore && room > bestRoom)) {
+            best = i;
+            bestScore = score;
+            bestRoom = room;
         }
     }
 
-    throw std::runtime_error("cannot find proper memory type!");
+    return best;
 }
 
-void appvk::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkBuffer& buf, VkDeviceMemory& bufMem) {
+uint32_t appvk::findMemoryType(uint32_t legalMemoryTypes, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkMemoryPropertyFlags avoided, VkDeviceSize size) {
+    std::optional<uint32_t> type = pickMemoryType(legalMemoryTypes, required, preferred, avoided, size);
+    if (!type) {
+        throw std::runtime_error("cannot find proper memory type!");
+    }
+
+    return *type;
+}
+
+// allocate device memory for a buffer or image and record it in the memory tracker
+void appvk::allocateMemory(const VkMemoryRequirements& mreq, VkMemoryPropertyFlags props, mem::category cat, VkDeviceMemory& m) {
+    const mem::preference pref = mem::categoryPreference(cat);
+    allocateMemory(mreq, findMemoryType(mreq.memoryTypeBits, props, pref.preferred, pref.avoided, mreq.size), cat, m);
+}
+
+void appvk::allocateMemory(const VkMemoryRequirements& mreq, uint32_t typeIndex, mem::category cat, VkDeviceMemory& m) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = mreq.size;
+    allocInfo.memoryTypeIndex = typeIndex;
+
+    if (vkAllocateMemory(dev, &allocInfo, nullptr, &m) != VK_SUCCESS) {
+        throw std::runtime_error(std::string("cannot allocate ") + mem::categoryName(cat) + " memory!");
+    }
+
+    mtrack.alloc(m, mreq.size, allocInfo.memoryTypeIndex, cat);
+}
+
+void appvk::freeMemory(VkDeviceMemory m) {
+    mtrack.free(m);
+    vkFreeMemory(dev, m, nullptr);
+}
+
+void appvk::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, mem::category cat, VkBuffer& buf, VkDeviceMemory& bufMem) {
     VkBufferCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     createInfo.size = size;
@@ -41,14 +127,7 @@ void appvk::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPr
     VkMemoryRequirements mreq{};
     vkGetBufferMemoryRequirements(dev, buf, &mreq);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = mreq.size;
-    allocInfo.memoryTypeIndex = findMemoryType(mreq.memoryTypeBits, props);
-
-    if (vkAllocateMemory(dev, &allocInfo, nullptr, &bufMem) != VK_SUCCESS) {
-        throw std::runtime_error("cannot allocate buffer memory!");
-    }
+    allocateMemory(mreq, props, cat, bufMem);
 
     vkBindBufferMemory(dev, buf, bufMem, 0);
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include <algorithm>
+
+#include "memtrack.hpp"
+
+const char* mem::categoryName(category c) {
+    switch (c) {
+        case vertex: return "vertex";
+        case index: return "index";
+        case instance: return "instance";
+        case texture: return "texture";
+        case attachment: return "attachment";
+        case staging: return "staging";
+        case uniform: return "uniform";
+        default: return "unknown";
+    }
+}
+
+mem::preference mem::categoryPreference(category c) {
+    switch (c) {
+        case staging:
+            // written once by the host and read once by a copy, so keep it out of scarce device-local host-visible memory
+            return { VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT };
+        case uniform:
+            // small and written every frame, the GPU reads it directly if it can
+            return { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT };
+        case attachment:
+            // transient attachments can live entirely in tile memory on tilers
+            return { VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT };
+        default:
+            return { 0, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT };
+    }
+}
+
+void mem::usage::add(VkDeviceSize size) {
+    current += size;
+    peak = std::max(peak, current);
+}
+
+void mem::usage::sub(VkDeviceSize size) {
+    current -= size;
+}
+
+void mem::tracker::init(VkPhysicalDevice pd, bool budgetSupported) {
+    pdev = pd;
+    budget = budgetSupported;
+    vkGetPhysicalDeviceMemoryProperties(pdev, &props);
+}
+
+void mem::tracker::alloc(VkDeviceMemory m, VkDeviceSize size, uint32_t typeIndex, category c) {
+    const uint32_t heap = props.memoryTypes[typeIndex].heapIndex;
+
+    live[m] = allocation{size, heap, c};
+    heaps[heap].add(size);
+    categories[c].add(size);
+}
+
+void mem::tracker::free(VkDeviceMemory m) {
+    auto it = live.find(m);
+    if (it == live.end()) {
+        return; // VK_NULL_HANDLE or memory we never saw
+    }
+
+    heaps[it->second.heap].sub(it->second.size);
+    categories[it->second.cat].sub(it->second.size);
+    live.erase(it);
+}
+
+void mem::tracker::report(std::ostream& os) const {
+    constexpr double mib = 1024.0 * 1024.0;
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProps{};
+    budgetProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    if (budget) {
+        VkPhysicalDeviceMemoryProperties2 props2{};
+        props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        props2.pNext = &budgetProps;
+        vkGetPhysicalDeviceMemoryProperties2(pdev, &props2);
+    }
+
+    os << "device memory (" << live.size() << " allocations):\n";
+
+    for (uint32_t i = 0; i < props.memoryHeapCount; i++) {
+        const bool local = props.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+        os << "\theap " << i << (local ? " (device local)" : " (host)")
+            << ": " << heaps[i].current / mib << " MiB used, "
+            << heaps[i].peak / mib << " MiB peak, "
+            << props.memoryHeaps[i].size / mib << " MiB total";
+
+        if (budget) {
+            // heapUsage counts every process, heapBudget is how much this process can use before things get evicted
+            os << ", " << budgetProps.heapUsage[i] / mib << " MiB in use by all processes, "
+                << budgetProps.heapBudget[i] / mib << " MiB budget";
+        }
+        os << "\n";
+    }
+
+    for (uint8_t c = 0; c < numCategories; c++) {
+        if (categories[c].peak == 0) {
+            continue;
+        }
+        os << "\t" << categoryName(category(c)) << ": "
+            << categories[c].current / mib << " MiB used, "
+            << categories[c].peak / mib << " MiB peak\n";
+    }
+}
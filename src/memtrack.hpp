@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <ostream>
+#include <unordered_map>
+
+#include "glfw_wrapper.hpp"
+
+namespace mem {
+    // what a device allocation is used for, so the report can say where memory went
+    enum category : uint8_t {
+        vertex,
+        index,
+        instance,
+        texture,
+        attachment,
+        staging,
+        uniform,
+        numCategories,
+    };
+
+    const char* categoryName(category c);
+
+    // memory property flags that are nice to have (or better to stay away from) for a category,
+    // on top of the flags the caller requires
+    struct preference {
+        VkMemoryPropertyFlags preferred;
+        VkMemoryPropertyFlags avoided;
+    };
+
+    preference categoryPreference(category c);
+
+    struct usage {
+        VkDeviceSize current = 0;
+        VkDeviceSize peak = 0;
+
+        void add(VkDeviceSize size);
+        void sub(VkDeviceSize size);
+    };
+
+    // tracks every vkAllocateMemory / vkFreeMemory made by the app, per heap and per category.
+    // if VK_EXT_memory_budget is enabled, the report also includes the driver's view of the heaps,
+    // which counts other processes using the same GPU.
+    class tracker {
+    public:
+        void init(VkPhysicalDevice pd, bool budgetSupported);
+
+        void alloc(VkDeviceMemory m, VkDeviceSize size, uint32_t typeIndex, category c);
+        void free(VkDeviceMemory m);
+
+        const usage& heapUsage(uint32_t heap) const { return heaps[heap]; }
+        const usage& categoryUsage(category c) const { return categories[c]; }
+
+        void report(std::ostream& os) const;
+
+    private:
+        struct allocation {
+            VkDeviceSize size;
+            uint32_t heap;
+            category cat;
+        };
+
+        VkPhysicalDevice pdev = VK_NULL_HANDLE;
+        bool budget = false;
+        VkPhysicalDeviceMemoryProperties props{};
+
+        std::unordered_map<VkDeviceMemory, allocation> live;
+        std::array<usage, VK_MAX_MEMORY_HEAPS> heaps;
+        std::array<usage, numCategories> categories;
+    };
+}
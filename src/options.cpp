@@ -0,0 +1,176 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "options.hpp"
+
+namespace {
+    void usage(const char* prog) {
+        std::cerr << "usage: " << prog << " [options]\n"
+            << "  --frames-in-flight=N    frames queued ahead of the GPU, 1-4 (default 2)\n"
+            << "  --present=MODE          immediate, mailbox, fifo or fifo_relaxed (default mailbox)\n"
+            << "  --low-latency           delay input sampling until just before the frame is needed\n"
+            << "  --on-demand             stop rendering while nothing on screen changes, starts without wind (which never stops)\n"
+            << "  --render-thread         render on a separate thread from window events and input\n"
+            << "  --tick-rate=N           simulation ticks per second, 1-1000 (default 60)\n"
+            << "  --max-fps=N             render at most N frames per second, 0-1000 (default 0, no limit)\n"
+            << "  --grass=MODE            scatter (instance buffer filled once) or field (no instance data) (default scatter)\n"
+            << "  --grass-per-triangle=N  grass candidates per terrain triangle with scatter grass, 1-64 (default 8)\n"
+            << "  --grass-clump=K         scatter grass draws K generated blades per instance, 1-16 (default 1, the grass model)\n"
+            << "  --grass-cells=N         field grass grid is N x N blades, 1-4096 (default 384)\n"
+            << "  --impostor-distance=N   field grass past about N is drawn as impostor cards, 0-1000, 0 for none (default 12)\n"
+            << "  --quality=TIER          low or high shading, Q switches while running (default high)\n"
+            << "  --wind, --no-wind       start with moving or still grass (default moving, still with --on-demand),\n"
+            << "                          B switches wind on and off while running\n"
+            << "  --pack=PATH             baked asset pack to load from (default assets.pack, empty for none)\n"
+            << "  --full-precision        shade terrain and grass in fp32 only, not fp16 or relaxed precision\n"
+            << "  --precision-check       compare a frame at reduced and full precision, exit 1 if they differ visibly\n"
+            << "  --watch-shaders         reload shaders when they change (shader/ with make live, .spv/ otherwise)\n";
+    }
+
+    unsigned int parseUint(std::string_view name, std::string_view value, unsigned int lo, unsigned int hi) {
+        size_t end = 0;
+        unsigned long v = 0;
+        try {
+            v = std::stoul(std::string(value), &end);
+        } catch (const std::exception&) {
+            end = 0;
+        }
+
+        if (value.empty() || end != value.size() || v < lo || v > hi) {
+            throw std::runtime_error(std::string(name) + " must be between " + std::to_string(lo) + " and " + std::to_string(hi) + "!");
+        }
+        return v;
+    }
+
+    options::present parsePresent(std::string_view value) {
+        for (auto p : { options::present::immediate, options::present::mailbox, options::present::fifo, options::present::fifoRelaxed }) {
+            if (value == options::presentName(p)) {
+                return p;
+            }
+        }
+        throw std::runtime_error("unknown present mode " + std::string(value) + "!");
+    }
+
+    options::quality parseQuality(std::string_view value) {
+        for (auto q : { options::quality::low, options::quality::high }) {
+            if (value == options::qualityName(q)) {
+                return q;
+            }
+        }
+        throw std::runtime_error("unknown quality tier " + std::string(value) + "!");
+    }
+
+    options::grass parseGrass(std::string_view value) {
+        for (auto g : { options::grass::scatter, options::grass::field }) {
+            if (value == options::grassName(g)) {
+                return g;
+            }
+        }
+        throw std::runtime_error("unknown grass mode " + std::string(value) + "!");
+    }
+}
+
+const char* options::presentName(present p) {
+    switch (p) {
+        case present::immediate: return "immediate";
+        case present::mailbox: return "mailbox";
+        case present::fifo: return "fifo";
+        case present::fifoRelaxed: return "fifo_relaxed";
+        default: return "unknown";
+    }
+}
+
+const char* options::qualityName(quality q) {
+    switch (q) {
+        case quality::low: return "low";
+        case quality::high: return "high";
+        default: return "unknown";
+    }
+}
+
+const char* options::grassName(grass g) {
+    switch (g) {
+        case grass::scatter: return "scatter";
+        case grass::field: return "field";
+        default: return "unknown";
+    }
+}
+
+options::runtime options::parse(int argc, char** argv) {
+    runtime r;
+    bool windSet = false;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                usage(argv[0]);
+                std::exit(0);
+            }
+
+            // all options are --name=value
+            const size_t eq = arg.find('=');
+            const std::string_view name = arg.substr(0, eq);
+            const std::string_view value = eq == std::string_view::npos ? std::string_view() : arg.substr(eq + 1);
+
+            if (name == "--frames-in-flight") {
+                r.framesInFlight = parseUint(name, value, 1, 4);
+            } else if (name == "--present") {
+                r.presentMode = parsePresent(value);
+            } else if (arg == "--low-latency") {
+                r.lowLatency = true;
+            } else if (arg == "--on-demand") {
+                r.onDemand = true;
+            } else if (arg == "--render-thread") {
+                r.renderThread = true;
+            } else if (name == "--tick-rate") {
+                r.tickRate = parseUint(name, value, 1, 1000);
+            } else if (name == "--max-fps") {
+                r.maxFps = parseUint(name, value, 0, 1000);
+            } else if (name == "--grass") {
+                r.grassMode = parseGrass(value);
+            } else if (name == "--grass-per-triangle") {
+                r.grassPerTriangle = parseUint(name, value, 1, 64);
+            } else if (name == "--grass-clump") {
+                r.grassClump = parseUint(name, value, 1, 16);
+            } else if (name == "--grass-cells") {
+                r.grassCells = parseUint(name, value, 1, 4096);
+            } else if (name == "--impostor-distance") {
+                r.impostorDistance = parseUint(name, value, 0, 1000);
+            } else if (name == "--quality") {
+                r.shading = parseQuality(value);
+            } else if (arg == "--wind" || arg == "--no-wind") {
+                r.wind = arg == "--wind";
+                windSet = true;
+            } else if (name == "--pack") {
+                r.packPath = value;
+            } else if (arg == "--watch-shaders") {
+                r.watchShaders = true;
+            } else if (arg == "--full-precision") {
+                r.halfShading = false;
+            } else if (arg == "--precision-check") {
+                r.precisionCheck = true;
+            } else {
+                throw std::runtime_error("unknown option " + std::string(arg) + "!");
+            }
+        }
+
+        // wind animates every frame, so on-demand rendering would never go idle with it on
+        if (!windSet) {
+            r.wind = !r.onDemand;
+        }
+
+        if (r.grassClump > 1 && r.grassMode != grass::scatter) {
+            throw std::runtime_error("--grass-clump only applies to scatter grass!");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        usage(argv[0]);
+        std::exit(1);
+    }
+
+    return r;
+}
@@ -1,11 +1,54 @@
 #pragma once
 
+#include <string>
+
 namespace options {
     // graphics options
     constexpr unsigned int msaaSamples = 2;
+    constexpr bool directUploads = true; // skip staging buffers when device-local memory is host-visible
 
     // gameplay options
     constexpr bool godMode = true;
     constexpr bool keyboardLook = true;
 	constexpr bool mouseLook = false;
-}
\ No newline at end of file
+
+    // swapchain present modes, fifo is the only one every device has to support
+    enum class present { immediate, mailbox, fifo, fifoRelaxed };
+
+    const char* presentName(present p);
+
+    // shading quality tiers, each one is its own set of specialized shaders
+    enum class quality { low, high };
+
+    const char* qualityName(quality q);
+
+    // where grass blades come from: scattered once into an instance buffer, or placed on a grid by the vertex shader
+    enum class grass { scatter, field };
+
+    const char* grassName(grass g);
+
+    // options that get tuned per deployment, set from the command line so they don't need a rebuild
+    struct runtime {
+        unsigned int framesInFlight = 2; // frames the CPU can queue up before waiting on the GPU, trades latency for throughput
+        present presentMode = present::mailbox;
+        bool lowLatency = false; // sample input as late as possible instead of rendering as far ahead as possible
+        bool onDemand = false; // only render when the view changed, sleep on window events otherwise
+        bool renderThread = false; // draw and present on a second thread, the main thread only handles window events and input
+        unsigned int tickRate = 60; // simulation updates per second, independent of the frame rate
+        unsigned int maxFps = 0; // render rate cap, 0 for none
+        grass grassMode = grass::scatter;
+        unsigned int grassPerTriangle = 8; // grass candidates scattered on each terrain triangle, the density map decides which stay
+        unsigned int grassClump = 1; // blades each scattered instance draws, generated in the vertex shader. 1 draws the grass model instead
+        unsigned int grassCells = 384; // field grass is one blade per cell of a grassCells x grassCells grid over the terrain
+        unsigned int impostorDistance = 12; // field grass further than this (world units, roughly) is drawn as baked impostor cards, 0 for blades everywhere
+        quality shading = quality::high; // starting tier, Q switches at runtime
+        bool wind = true; // grass moves in a GPU-animated wind field, B toggles at runtime. off by default with onDemand
+        std::string packPath = "assets.pack"; // baked assets (see baker/), empty to always load source assets
+        bool watchShaders = false; // rebuild pipelines when their shaders change on disk
+        bool halfShading = true; // terrain and grass color math in fp16 where the device supports it, relaxed precision otherwise
+        bool precisionCheck = false; // render one frame at full and at reduced precision, compare them and exit
+    };
+
+    // exits with a usage message if an option is unknown or out of range
+    runtime parse(int argc, char** argv);
+}
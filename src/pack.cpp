@@ -0,0 +1,115 @@
+#include <cstring>
+#include <iostream>
+
+#include <sys/stat.h>
+
+#include "pack.hpp"
+
+namespace {
+    uint64_t expectedSize(const pack::entry& e, uint32_t vertexSize) {
+        switch (e.type) {
+            case pack::kind::mesh:
+                return uint64_t(e.vertexCount()) * vertexSize + uint64_t(e.indexCount()) * sizeof(uint32_t);
+            case pack::kind::image: {
+                if (e.mipLevels() == 0 || e.mipLevels() > 32) {
+                    return ~uint64_t(0);
+                }
+                uint64_t size = 0;
+                for (uint32_t l = 0; l < e.mipLevels(); l++) {
+                    size += pack::mipSize(e, l) * e.layers();
+                }
+                return size;
+            }
+            case pack::kind::shader:
+                return e.size % 4 == 0 ? e.size : ~uint64_t(0); // spir-v is a stream of words
+            default:
+                return ~uint64_t(0);
+        }
+    }
+}
+
+bool pack::archive::open(const std::string& path, uint32_t vertexSize) {
+    close();
+
+    if (!file.open(path)) {
+        return false; // no pack is fine, assets get loaded from their source files
+    }
+    const size_t length = file.size();
+    if (length < sizeof(header)) {
+        std::cerr << "ignoring " << path << ": too small\n";
+        close();
+        return false;
+    }
+
+    hdr = reinterpret_cast<const header*>(file.data());
+
+    const char* problem = nullptr;
+    if (hdr->magic != magic || hdr->version != version) {
+        problem = "not a pack file, or from a different version";
+    } else if (hdr->vertexSize != vertexSize) {
+        problem = "baked with a different vertex format";
+    } else if (hdr->tocOffset % alignof(entry) != 0 || hdr->tocOffset > length || (length - hdr->tocOffset) / sizeof(entry) < hdr->entryCount) {
+        problem = "table of contents out of bounds";
+    } else {
+        toc = reinterpret_cast<const entry*>(file.data() + hdr->tocOffset);
+        for (uint32_t i = 0; i < hdr->entryCount; i++) {
+            if (toc[i].offset > length || toc[i].size > length - toc[i].offset || !memchr(toc[i].name, 0, sizeof(toc[i].name))) {
+                problem = "corrupt entry";
+                break;
+            }
+            if (toc[i].offset % payloadAlign != 0 || toc[i].size != expectedSize(toc[i], vertexSize)) {
+                problem = "payload does not match its description";
+                break;
+            }
+        }
+    }
+
+    if (problem) {
+        std::cerr << "ignoring " << path << ": " << problem << "\n";
+        close();
+        return false;
+    }
+
+    // payloads are read front to back once at startup
+    file.prefetch();
+    return true;
+}
+
+void pack::archive::close() {
+    file.close();
+    hdr = nullptr;
+    toc = nullptr;
+}
+
+bool pack::archive::changed(std::string_view source) const {
+    struct stat st;
+    if (stat(std::string(source).c_str(), &st) == 0 && st.st_mtime > file.modified()) {
+        std::cerr << source << " changed since the pack was baked, loading it from source\n";
+        return true;
+    }
+    return false;
+}
+
+const pack::entry* pack::archive::find(std::string_view name) const {
+    if (!hdr) {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < hdr->entryCount; i++) {
+        if (name != toc[i].name) {
+            continue;
+        }
+
+        // names are source paths, except for the cubemap, which is baked from its faces
+        if (name == cubemapName) {
+            for (std::string_view face : cubemapFaces) {
+                if (changed(face)) {
+                    return nullptr;
+                }
+            }
+        } else if (changed(name)) {
+            return nullptr;
+        }
+        return &toc[i];
+    }
+    return nullptr;
+}
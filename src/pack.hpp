@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.hpp"
+
+namespace pack {
+    // a pack file is a header, then payloads (each aligned to payloadAlign), then a table of contents at tocOffset.
+    // payloads are stored exactly as the GPU wants them, so loading one is a single memcpy into staging memory.
+    constexpr uint32_t magic = 0x504b4756; // "VGKP"
+    constexpr uint32_t version = 1;
+    constexpr uint64_t payloadAlign = 256; // also a valid copy source alignment for any texel format
+
+    enum class kind : uint32_t {
+        mesh, // vformat::vertex array, then uint32_t indices
+        image, // rgba8 srgb, mip 0 of every layer, then mip 1 of every layer, and so on (the order vkCmdCopyBufferToImage wants)
+        shader, // spir-v
+    };
+
+    struct header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexSize; // sizeof(vformat::vertex) when baked, meshes are unusable if that changed
+        uint32_t entryCount;
+        uint64_t tocOffset;
+    };
+
+    struct entry {
+        char name[88]; // source path, nul terminated
+        kind type;
+        uint32_t info[4]; // mesh: vertex count, index count. image: width, height, mip levels, layers.
+        uint32_t reserved;
+        uint64_t offset;
+        uint64_t size;
+
+        uint32_t vertexCount() const { return info[0]; }
+        uint32_t indexCount() const { return info[1]; }
+        uint32_t width() const { return info[0]; }
+        uint32_t height() const { return info[1]; }
+        uint32_t mipLevels() const { return info[2]; }
+        uint32_t layers() const { return info[3]; }
+    };
+
+    static_assert(sizeof(header) == 24, "pack header layout changed");
+    static_assert(sizeof(entry) == 128, "pack entry layout changed");
+
+    // the cubemap is baked as one 6 layer image under this name, from these faces in this order (+x, -x, +y, -y, +z, -z)
+    constexpr std::string_view cubemapName = "textures/skybox";
+    constexpr std::array<std::string_view, 6> cubemapFaces = {
+        "textures/right.jpg",
+        "textures/left.jpg",
+        "textures/top.jpg",
+        "textures/bottom.jpg",
+        "textures/front.jpg",
+        "textures/back.jpg",
+    };
+
+    // bytes of mip level `level` of one layer
+    inline uint64_t mipSize(const entry& e, uint32_t level) {
+        const uint64_t w = e.width() >> level, h = e.height() >> level;
+        return (w ? w : 1) * (h ? h : 1) * 4;
+    }
+
+    // read-only view of a pack file mapped into memory, nothing is read until a payload is touched.
+    // entries whose source file changed after the pack was baked are skipped, so a stale pack never hides an edit.
+    class archive {
+    public:
+        // false (with the reason printed) if the file is missing, corrupt or from an incompatible build
+        bool open(const std::string& path, uint32_t vertexSize);
+        void close();
+
+        bool isOpen() const { return hdr != nullptr; }
+        const entry* find(std::string_view name) const;
+        const uint8_t* data(const entry& e) const { return file.data() + e.offset; }
+
+    private:
+        bool changed(std::string_view source) const; // since the pack was baked
+
+        io::mappedFile file;
+        const header* hdr = nullptr;
+        const entry* toc = nullptr;
+    };
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "profiler.hpp"
+
+void prof::history::push(double ms) {
+    samples[next] = ms;
+    next = (next + 1) % window;
+    count = std::min(count + 1, window);
+}
+
+double prof::history::last() const {
+    return count ? samples[(next + window - 1) % window] : 0.0;
+}
+
+double prof::history::mean() const {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    return count ? sum / count : 0.0;
+}
+
+double prof::history::max() const {
+    return count ? *std::max_element(samples.begin(), samples.begin() + count) : 0.0;
+}
+
+double prof::history::min() const {
+    return count ? *std::min_element(samples.begin(), samples.begin() + count) : 0.0;
+}
+
+uint32_t prof::gpuTimer::addZone(std::string name) {
+    zones.push_back(zoneInfo{std::move(name), history{}});
+    return zones.size() - 1;
+}
+
+void prof::gpuTimer::init(VkPhysicalDevice pd, VkDevice d, uint32_t queueFamily) {
+    dev = d;
+
+    VkPhysicalDeviceProperties dprop;
+    vkGetPhysicalDeviceProperties(pd, &dprop);
+
+    uint32_t numFamilies = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(pd, &numFamilies, nullptr);
+    std::vector<VkQueueFamilyProperties> families(numFamilies);
+    vkGetPhysicalDeviceQueueFamilyProperties(pd, &numFamilies, families.data());
+
+    const uint32_t validBits = families[queueFamily].timestampValidBits;
+    enabled = validBits != 0 && dprop.limits.timestampPeriod > 0.0f;
+    period = dprop.limits.timestampPeriod;
+    mask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+}
+
+void prof::gpuTimer::create(uint32_t images) {
+    if (!enabled || zones.empty()) {
+        return;
+    }
+
+    VkQueryPoolCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.queryCount = images * zones.size() * 2;
+
+    if (vkCreateQueryPool(dev, &createInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create timestamp query pool!");
+    }
+
+    results.resize(zones.size() * 2);
+}
+
+void prof::gpuTimer::destroy() {
+    vkDestroyQueryPool(dev, pool, nullptr);
+    pool = VK_NULL_HANDLE;
+}
+
+void prof::gpuTimer::reset(VkCommandBuffer cbuf, uint32_t image) {
+    if (pool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(cbuf, pool, image * zones.size() * 2, zones.size() * 2);
+    }
+}
+
+void prof::gpuTimer::begin(VkCommandBuffer cbuf, uint32_t image, uint32_t zone) {
+    if (pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(cbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, (image * zones.size() + zone) * 2);
+    }
+}
+
+void prof::gpuTimer::end(VkCommandBuffer cbuf, uint32_t image, uint32_t zone) {
+    if (pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(cbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, (image * zones.size() + zone) * 2 + 1);
+    }
+}
+
+void prof::gpuTimer::collect(uint32_t image) {
+    if (pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    const uint32_t first = image * zones.size() * 2;
+    VkResult r = vkGetQueryPoolResults(dev, pool, first, results.size(), results.size() * sizeof(uint64_t),
+        results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (r != VK_SUCCESS) {
+        return; // not written yet, e.g. the first use of a new command buffer
+    }
+
+    for (size_t z = 0; z < zones.size(); z++) {
+        const uint64_t ticks = (results[z * 2 + 1] - results[z * 2]) & mask;
+        zones[z].times.push(ticks * period / 1e6);
+    }
+}
+
+void prof::gpuTimer::report(std::ostream& os) const {
+    if (!enabled) {
+        os << "gpu timestamps not supported\n";
+        return;
+    }
+    for (const auto& z : zones) {
+        os << "\tgpu " << z.name << ": " << z.times.mean() << " ms avg, " << z.times.max() << " ms max\n";
+    }
+}
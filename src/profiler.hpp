@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "glfw_wrapper.hpp"
+
+namespace prof {
+    // the last few samples of something measured once per frame, in milliseconds
+    class history {
+    public:
+        constexpr static size_t window = 32;
+
+        void push(double ms);
+
+        double last() const;
+        double mean() const;
+        double max() const;
+        double min() const;
+        bool empty() const { return count == 0; }
+
+    private:
+        std::array<double, window> samples{};
+        size_t next = 0;
+        size_t count = 0;
+    };
+
+    // GPU time spent in named zones of the prerecorded command buffers.
+    // each swapchain image gets its own range of queries, so a command buffer's results can be read back
+    // without stalling once the frame that last used it has completed.
+    class gpuTimer {
+    public:
+        // zones have to be added before create(), since they decide the query pool size
+        uint32_t addZone(std::string name);
+
+        void init(VkPhysicalDevice pd, VkDevice dev, uint32_t queueFamily);
+        void create(uint32_t images);
+        void destroy();
+
+        // recorded into the command buffer for an image, reset() has to come before any zone and outside a render pass
+        void reset(VkCommandBuffer cbuf, uint32_t image);
+        void begin(VkCommandBuffer cbuf, uint32_t image, uint32_t zone);
+        void end(VkCommandBuffer cbuf, uint32_t image, uint32_t zone);
+
+        // read back the results for an image, only call once the frame that last used it is complete
+        void collect(uint32_t image);
+
+        bool supported() const { return enabled; }
+        const history& times(uint32_t zone) const { return zones[zone].times; }
+
+        void report(std::ostream& os) const;
+
+    private:
+        struct zoneInfo {
+            std::string name;
+            history times;
+        };
+
+        VkDevice dev = VK_NULL_HANDLE;
+        bool enabled = false;
+        double period = 1.0; // nanoseconds per tick
+        uint64_t mask = ~0ull; // timestamps only have timestampValidBits significant bits
+
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::vector<zoneInfo> zones;
+        std::vector<uint64_t> results; // no allocation in collect()
+    };
+}
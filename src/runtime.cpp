@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <iomanip>
+#include <thread>
 
 #include "options.hpp"
 
@@ -9,28 +12,97 @@
 void appvk::createSyncs() {
     imageAvailSems.resize(framesInFlight, VK_NULL_HANDLE);
     renderDoneSems.resize(framesInFlight, VK_NULL_HANDLE);
-    inFlightFences.resize(framesInFlight, VK_NULL_HANDLE);
-    imagesInFlight = std::vector<VkFence>(swapImages.size(), VK_NULL_HANDLE); // this needs to be re-created on a window resize
+    frameSerials.resize(framesInFlight, 0);
+    imageSerials = std::vector<uint64_t>(swapImages.size(), 0); // this needs to be re-created on a window resize
     
     VkSemaphoreCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    
-    VkFenceCreateInfo fCreateInfo{};
-    fCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
     for (unsigned int i = 0; i < framesInFlight; i++) {
         VkResult r1 = vkCreateSemaphore(dev, &createInfo, nullptr, &imageAvailSems[i]);
         VkResult r2 = vkCreateSemaphore(dev, &createInfo, nullptr, &renderDoneSems[i]);
-        VkResult r3 = vkCreateFence(dev, &fCreateInfo, nullptr, &inFlightFences[i]);
         
-        if (r1 != VK_SUCCESS || r2 != VK_SUCCESS || r3 != VK_SUCCESS) {
+        if (r1 != VK_SUCCESS || r2 != VK_SUCCESS) {
             throw std::runtime_error("cannot create sync objects!");
         }
     }
+
+    // start where the last timeline left off so serials keep increasing across swapchain recreation
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = submittedSerial;
+
+    VkSemaphoreCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timelineInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(dev, &timelineInfo, nullptr, &frameTimeline) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create timeline semaphore!");
+    }
+}
+
+// block until the GPU has finished the frame with the given serial
+void appvk::waitForFrame(uint64_t serial) {
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &frameTimeline;
+    waitInfo.pValues = &serial;
+
+    vkWaitSemaphores(dev, &waitInfo, UINT64_MAX);
+}
+
+uint64_t appvk::completedSerial() {
+    uint64_t value;
+    vkGetSemaphoreCounterValue(dev, frameTimeline, &value);
+    return value;
+}
+
+// called before input is sampled for a frame
+void appvk::paceFrame() {
+    // cap the render rate, the simulation keeps ticking at its own rate either way
+    if (settings.maxFps > 0) {
+        std::this_thread::sleep_until(lastFrameStart + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / settings.maxFps)));
+        lastFrameStart = clock::now();
+    }
+
+    // wait for the frame that last used this slot's semaphores to finish on the GPU
+    waitForFrame(frameSerials[currFrame]);
+
+    // anything retired before the last completed frame was submitted can be destroyed now
+    deletions.collect(completedSerial());
+
+    paceDelay = 0.0;
+    if (!settings.lowLatency) {
+        return;
+    }
+
+    // don't queue frames behind the GPU, the input in a queued frame is stale by the time it gets drawn
+    waitForFrame(submittedSerial);
+
+    // any time a frame spent blocked after sampling input (waiting for vblank, mostly) is added latency.
+    // move that wait in front of input sampling instead, keeping a margin for frames that run long.
+    // the margin follows the GPU frame time jitter, since that's what decides whether a frame misses its refresh.
+    const prof::history& gpu = gpuTimes.times(frameZone);
+    const double margin = 0.5 + (gpu.max() - gpu.mean()) + (inputLatency.max() - inputLatency.mean());
+
+    if (!frameSlack.empty() && frameSlack.min() > margin) {
+        paceDelay = frameSlack.min() - margin;
+        const clock::time_point start = clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(paceDelay));
+        paceDelay = std::chrono::duration<double, std::milli>(clock::now() - start).count(); // sleep overshoots
+    }
+}
+
+void appvk::reportFrameTimes() {
+    cout << "frame times (last " << prof::history::window << " frames):\n";
+    cout << "\tinput to submit: " << inputLatency.mean() << " ms avg, " << inputLatency.max() << " ms max\n";
+    cout << "\tpacing delay: " << paceDelay << " ms, slack " << frameSlack.min() << " ms min\n";
+    gpuTimes.report(cout);
 }
 
-void appvk::updateUniformBuffer(uint32_t imageIndex) {
+void appvk::updateUniformBuffer(uint32_t imageIndex, const cameraState& cam) {
     //using namespace std::chrono;
     //static auto last = high_resolution_clock::now();
     //auto current = high_resolution_clock::now();
@@ -42,14 +114,26 @@ void appvk::updateUniformBuffer(uint32_t imageIndex) {
     // camera flips Y automatically
     float height;
     if (options::godMode) {
-        height = c.pos.y;
+        height = cam.pos.y;
     } else {
-        height = t.getHeight(c.pos.x, c.pos.z) + 1.0f;
+        height = t.getHeight(cam.pos.x, cam.pos.z) + 1.0f;
     }
 
-    const glm::vec3 p = glm::vec3(c.pos.x, height, c.pos.z);
-    u.view = glm::lookAt(p, p + c.front, glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::vec3 p = glm::vec3(cam.pos.x, height, cam.pos.z);
+    u.view = glm::lookAt(p, p + cam.front, glm::vec3(0.0f, 1.0f, 0.0f));
     u.proj = glm::perspective(glm::radians(25.0f), swapExtent.width / float(swapExtent.height), 0.1f, 100.0f);
+    u.time = std::chrono::duration<float>(clock::now() - startTime).count();
+    u.windStrength = windOn ? 1.0f : 0.0f;
+    u.trampleBounds = glm::vec4(terrainOrigin, terrainSize);
+
+    // field grass blades are drawn in a window of whole cards centered on the camera, the cards take over at its edge
+    u.nearFirst = glm::uvec2(0);
+    if (impostors) {
+        const float g = grassField.cardCells;
+        const glm::vec2 card = (glm::vec2(cam.pos.x, cam.pos.z) - grassField.origin) / grassField.size * (grassField.cells / g);
+        const float maxFirst = (grassField.cells - grassField.nearSide) / grassField.cardCells;
+        u.nearFirst = glm::uvec2(glm::clamp(glm::round(card - grassField.nearSide / (2.0f * g)), 0.0f, maxFirst)) * grassField.cardCells;
+    }
 
     void* data;
     vkMapMemory(dev, mvpMemories[imageIndex], 0, sizeof(mvp), 0, &data);
@@ -57,31 +141,119 @@ void appvk::updateUniformBuffer(uint32_t imageIndex) {
     vkUnmapMemory(dev, mvpMemories[imageIndex]);
 }
 
-// one grass section per triangle, centered on a vertex
-void appvk::initGrass(const std::vector<vformat::vertex>& verts, const std::vector<uint32_t>& indices) {
-    const size_t vsize = verts.size();
-    const size_t csize = indices.size() / 3;
+// the CPU side of trampling, written into this image's trampleBufs: the contacts to stamp this frame as texel rects,
+// the tiles still standing back up, and both dispatch sizes to go with them (see recordTrample). everything the GPU
+// touches is bounded by what is actually being trampled or recovering, an untouched field costs nothing.
+void appvk::updateTrample(uint32_t imageIndex, const cameraState& cam) {
+    const auto now = clock::now();
+    const float dt = lastTrample == clock::time_point{} ? 0.0f : std::min(std::chrono::duration<float>(now - lastTrample).count(), 0.25f);
+    lastTrample = now;
 
-    grassMatBuf.resize(vsize + csize);
-    
-    size_t mat_i = 0;
+    trampleFrame* f;
+    vkMapMemory(dev, trampleMems[imageIndex], 0, sizeof(trampleFrame), 0, reinterpret_cast<void**>(&f));
+    f->contacts = 0;
+    f->bounds = glm::vec4(terrainOrigin, terrainSize);
 
-    // write mats for each vertex
-    for (size_t i = 0; i < vsize; i++) {
-        const glm::vec3 p = verts[i].pos;
-        grassMatBuf[mat_i++] = glm::translate(glm::mat4(1.0f), p);
+    const glm::vec2 texel = terrainSize / float(trampleSize);
+    uint32_t maxArea = 0;
+    auto contact = [&](glm::vec2 center, float radius, float strength) {
+        if (f->contacts == maxContacts || strength <= 0.0f) {
+            return;
+        }
+
+        const glm::ivec2 lo = glm::clamp(glm::ivec2(glm::floor((center - radius - terrainOrigin) / texel)), 0, int(trampleSize));
+        const glm::ivec2 hi = glm::clamp(glm::ivec2(glm::ceil((center + radius - terrainOrigin) / texel)), 0, int(trampleSize));
+        if (hi.x <= lo.x || hi.y <= lo.y) {
+            return; // off the terrain
+        }
+
+        f->contact[f->contacts++] = { glm::vec4(center, radius, strength), { lo.x, lo.y, hi.x - lo.x, hi.y - lo.y } };
+        maxArea = std::max(maxArea, uint32_t((hi.x - lo.x) * (hi.y - lo.y)));
+
+        // grass under the contact is only fully upright again trampleRecoverySeconds after it was last stamped
+        for (int y = lo.y / trampleTile; y <= (hi.y - 1) / int(trampleTile); y++) {
+            for (int x = lo.x / trampleTile; x <= (hi.x - 1) / int(trampleTile); x++) {
+                float& r = tileRecovery[y * trampleTiles + x];
+                if (r <= 0.0f) {
+                    activeTiles.push_back(y * trampleTiles + x);
+                }
+                r = trampleRecoverySeconds;
+            }
+        }
+    };
+
+    // the camera walks through the grass, in god mode only while flying low enough for its feet to reach it
+    float strength = 1.0f;
+    if (options::godMode) {
+        const float feet = cam.pos.y - 1.0f; // same eye height as updateUniformBuffer
+        strength = std::clamp(1.0f - (feet - t.getHeight(cam.pos.x, cam.pos.z)) / 0.5f, 0.0f, 1.0f);
     }
-    
-    // write mats for lerped positions using indices
-    /*
-    const size_t isize = indices.size();
-    for (size_t i = 0; i < isize; i += 3) {
-        const glm::vec3 p0 = verts[indices[i]].pos;
-        const glm::vec3 p1 = verts[indices[i + 1]].pos;
-        const glm::vec3 p2 = verts[indices[i + 2]].pos;
-        
-        const glm::vec3 pl = glm::mix(glm::mix(p0, p1, 0.5f), p2, 0.5f);
-        grassMatBuf[mat_i++] = glm::translate(glm::mat4(1.0f), pl);
+    contact(glm::vec2(cam.pos.x, cam.pos.z), 0.6f, strength);
+
+    // only the tiles still recovering are visited, dispatch order doesn't matter so finished ones are swapped out
+    uint32_t tiles = 0;
+    for (size_t a = 0; a < activeTiles.size();) {
+        const uint32_t i = activeTiles[a];
+        f->tiles[tiles][0] = i % trampleTiles;
+        f->tiles[tiles][1] = i / trampleTiles;
+        tiles++;
+        tileRecovery[i] = std::max(tileRecovery[i] - dt, 0.0f);
+        if (tileRecovery[i] <= 0.0f) {
+            activeTiles[a] = activeTiles.back();
+            activeTiles.pop_back();
+        } else {
+            a++;
+        }
+    }
+
+    f->stamp = { (maxArea + 63) / 64, f->contacts, 1 }; // trample.comp's local size
+    f->recover = { tiles, 1, 1 };
+    f->recovered = dt / trampleRecoverySeconds;
+    vkUnmapMemory(dev, trampleMems[imageIndex]);
+
+    trampleRecovering = tiles > 0;
+}
+
+// renders the starting view at the reduced precision in use and at fp32, then compares the two images.
+// differences are per 8 bit channel, alpha ignored. passes if no channel is off by more than maxPrecisionError
+// and the whole image is at least minPrecisionPsnr.
+bool appvk::checkPrecision() {
+    if (precision == fragPrecision::full) {
+        cout << "shading in fp32 already, nothing to compare\n";
+        return true;
     }
-    */
-}
\ No newline at end of file
+
+    const cameraState cam{c.pos, c.front};
+    const fragPrecision reduced = precision;
+    const std::vector<uint8_t> test = captureFrame(cam);
+
+    precision = fragPrecision::full;
+    createGraphicsPipeline();
+    const std::vector<uint8_t> reference = captureFrame(cam);
+
+    precision = reduced;
+    createGraphicsPipeline(); // still built, only points terrainPipe and grassPipe back at it
+
+    unsigned int maxError = 0;
+    size_t differing = 0; // pixels with any channel off
+    double squaredError = 0.0;
+    for (size_t px = 0; px < test.size(); px += 4) {
+        bool differs = false;
+        for (size_t ch = 0; ch < 3; ch++) {
+            const int d = std::abs(int(test[px + ch]) - int(reference[px + ch]));
+            maxError = std::max(maxError, unsigned(d));
+            squaredError += d * d;
+            differs |= d != 0;
+        }
+        differing += differs;
+    }
+
+    const double mse = squaredError / (test.size() / 4 * 3);
+    const double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+    const bool passed = maxError <= maxPrecisionError && psnr >= minPrecisionPsnr;
+
+    cout << precisionName(reduced) << " against fp32 at " << swapExtent.width << "x" << swapExtent.height << ": "
+        << differing << " pixels differ, max error " << maxError << "/255, psnr " << std::fixed << std::setprecision(1) << psnr << " dB"
+        << (passed ? " (passed)\n" : " (failed)\n");
+    return passed;
+}
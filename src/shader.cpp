@@ -1,38 +1,249 @@
 #include "extensions.hpp"
 #include "main.hpp"
 
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <set>
 #include <string>
+#include <utility>
 
-std::vector<char> appvk::readFile(std::string_view path) {
-    std::ifstream file(path.data(), std::ios::ate | std::ios::binary);
+#include "mapped_file.hpp"
 
-    if (!file) {
-        throw std::runtime_error(std::string("cannot open file ") + path.data() + "!");
+namespace {
+    // builds of one source with an extra define, .spv/<source>.<variant>.spv (see shader/makefile)
+    struct shaderVariant {
+        std::string_view suffix;
+        const char* define;
+    };
+    constexpr shaderVariant shaderVariants[] = {
+        { ".f16", "HALF_SHADING" },
+        { ".relaxed", "RELAXED_SHADING" },
+    };
+
+    // "terrain.frag.f16" is the f16 build of "terrain.frag", no variant is the plain build
+    std::pair<std::string_view, const shaderVariant*> splitVariant(std::string_view name) {
+        for (const shaderVariant& v : shaderVariants) {
+            if (name.size() > v.suffix.size() && name.substr(name.size() - v.suffix.size()) == v.suffix) {
+                return { name.substr(0, name.size() - v.suffix.size()), &v };
+            }
+        }
+        return { name, nullptr };
     }
-    
-    size_t len = static_cast<size_t>(file.tellg());
-    file.seekg(0);
-    
-    std::vector<char> contents(len); // using vector of char because spir-v isn't a string
-    file.read(contents.data(), len);
-    
-    file.close();
 
-    return contents;
+    // the sources in shader/ that #include name, directly or through other includes
+    std::vector<std::string> includers(const std::string& name) {
+        namespace fs = std::filesystem;
+        auto includes = [](const fs::path& file, const std::set<std::string>& names) {
+            std::ifstream in(file);
+            std::string line;
+            while (std::getline(in, line)) {
+                for (const std::string& n : names) {
+                    if (line.find("#include \"" + n + "\"") != std::string::npos) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
+        std::set<std::string> names = { name };
+        std::error_code ec;
+        for (bool grew = true; grew;) {
+            grew = false;
+            for (const auto& e : fs::directory_iterator("shader/include", ec)) {
+                const std::string n = e.path().filename().string();
+                if (!names.count(n) && includes(e.path(), names)) {
+                    names.insert(n);
+                    grew = true;
+                }
+            }
+        }
+
+        std::vector<std::string> out;
+        for (const auto& e : fs::directory_iterator("shader", ec)) {
+            if (e.is_regular_file() && includes(e.path(), names)) {
+                out.push_back(e.path().filename().string());
+            }
+        }
+        return out;
+    }
+}
+
+// spir-v goes to the driver straight from the mapping (of the pack or the file), no copy.
+// after the first load the registry answers without touching the filesystem.
+VkShaderModule appvk::loadShaderModule(std::string_view path) {
+    if (VkShaderModule m = shaders.find(path)) {
+        return m;
+    }
+    if (!glsl::compiler::available) {
+        if (const pack::entry* e = assetPack.find(path); e && e->type == pack::kind::shader) {
+            return shaders.add(path, assetPack.data(*e), e->size);
+        }
+    }
+    return readShaderModule(path);
 }
 
-VkShaderModule appvk::createShaderModule(const std::vector<char>& spv) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = spv.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(spv.data());
+// always goes to disk (never the pack, which is stale once a shader has been edited), replacing whatever the
+// registry had under path. throws if the shader doesn't compile.
+VkShaderModule appvk::readShaderModule(std::string_view path) {
+    if constexpr (glsl::compiler::available) {
+        // .spv/<name>[.<variant>].spv is compiled from shader/<name>
+        std::string_view file = path.substr(path.rfind('/') + 1);
+        auto [name, variant] = splitVariant(file.substr(0, file.size() - 4));
+        const std::string source = "shader/" + std::string(name);
+        glsl::compiler::result r = glslc.compile(source, variant ? std::vector<std::string>{variant->define} : std::vector<std::string>{});
+        if (verbose) {
+            cout << source << (r.cached ? " (cached)\n" : " compiled\n");
+        }
+        return shaders.add(path, r.spv.data(), r.spv.size() * sizeof(uint32_t));
+    }
+
+    io::mappedFile spv{std::string(path)};
+    return shaders.add(path, spv.data(), spv.size());
+}
+
+// rebuilds every pipeline that uses a changed shader. anything that fails to compile or link is reported and
+// the pipelines it would have replaced keep rendering, so a typo in the editor doesn't take the app down.
+void appvk::reloadShaders() {
+    std::vector<std::string> changed = shaderWatch.poll();
+    if (includeWatch.watching()) {
+        // an edited include is an edit to every shader that uses it
+        for (const std::string& file : includeWatch.poll()) {
+            for (std::string& user : includers(file)) {
+                changed.push_back(std::move(user));
+            }
+        }
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    }
+    if (changed.empty()) {
+        return;
+    }
+
+    const auto start = clock::now();
 
-    VkShaderModule mod;
-    if (vkCreateShaderModule(dev, &createInfo, nullptr, &mod) != VK_SUCCESS) {
-        throw std::runtime_error("cannot create shader module!");
+    // pipelines are named after the shaders they use, terrain.vert.spv and terrain.frag.spv go into the terrain pipeline
+    struct replaced {
+        vkr::pipeline* slot;
+        vkr::pipeline old;
+    };
+    std::vector<replaced> stale;
+    auto replace = [&stale](vkr::pipeline& p) {
+        if (p) { // null if already replaced, or a variant that was never built
+            stale.push_back({&p, std::move(p)});
+        }
+    };
+
+    // the directory also sees makefiles, editor swap files and the like
+    auto endsWith = [](std::string_view s, std::string_view suffix) {
+        return s.size() > suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+    };
+
+    // modules replaced below stay around until the pipelines using the new ones are built
+    shaders.beginReplace();
+    for (const std::string& file : changed) {
+        std::string name = file;
+        if (!glsl::compiler::available) {
+            if (!endsWith(name, ".spv")) {
+                continue;
+            }
+            name.resize(name.size() - 4);
+        }
+        const std::string_view source = splitVariant(name).first;
+        if (!endsWith(source, ".vert") && !endsWith(source, ".frag") && !endsWith(source, ".comp")) {
+            continue;
+        }
+        std::string stem(source.substr(0, source.find('.')));
+        if (stem == "scatter") {
+            cout << file << " is not hot-reloadable, grass is only scattered while loading\n";
+            continue;
+        }
+        if (stem == "impostorbake") {
+            cout << file << " is not hot-reloadable, impostors are only baked while loading\n";
+            continue;
+        }
+        if (stem == "grassfield" || stem == "grassclump") {
+            stem = "grass"; // the other grass vertex shaders go into the grass pipeline too
+        }
+
+        // a changed .spv is one build, a changed source is every build of it. only what's in use gets reloaded.
+        std::vector<std::string> paths = { ".spv/" + name + ".spv" };
+        if (glsl::compiler::available) {
+            for (const shaderVariant& v : shaderVariants) {
+                paths.push_back(".spv/" + name + std::string(v.suffix) + ".spv");
+            }
+        }
+        paths.erase(std::remove_if(paths.begin(), paths.end(), [this](const std::string& p) { return !shaders.find(p); }), paths.end());
+        if (paths.empty()) {
+            cout << "no pipeline uses " << file << "\n";
+            continue;
+        }
+
+        try {
+            for (const std::string& p : paths) {
+                readShaderModule(p);
+            }
+        } catch (const std::exception& e) {
+            cerr << file << ": " << e.what() << "\n";
+            for (const std::string& p : paths) {
+                shaders.rollback(p); // builds that did compile don't get used without the rest
+            }
+            continue;
+        }
+
+        // shading variants that aren't current get rebuilt when they are switched to
+        if (stem == "terrain" || stem == "grass" || stem == "impostor") {
+            for (auto& [key, variant] : shadedVariants) {
+                replace(stem == "terrain" ? variant.terrain : stem == "grass" ? variant.grass : variant.impostor);
+            }
+            if (impostors && source == "grass.frag") {
+                cout << "impostor cards keep the grass baked while loading, impostorbake.frag shades them\n";
+            }
+        } else if (stem == "skybox") {
+            replace(skyPipe);
+        } else if (stem == "wind") {
+            replace(windPipe);
+        } else if (stem == "trample") {
+            replace(stampPipe);
+        } else if (stem == "recover") {
+            replace(recoverPipe);
+        }
+    }
+    if (stale.empty()) {
+        shaders.commit();
+        return;
     }
-    return mod;
+    const auto compiled = clock::now();
+
+    try {
+        createGraphicsPipeline(); // builds the pipelines that were just moved out
+        // the per-frame compute passes, each is only set up (has a layout) when the app uses it
+        auto rebuild = [this](vkr::pipeline& p, std::string_view shader, VkPipelineLayout layout) {
+            if (!p && layout != VK_NULL_HANDLE) {
+                p = createComputePipeline(shader, layout);
+            }
+        };
+        rebuild(windPipe, ".spv/wind.comp.spv", windPipeLayout);
+        rebuild(stampPipe, ".spv/trample.comp.spv", tramplePipeLayout);
+        rebuild(recoverPipe, ".spv/recover.comp.spv", tramplePipeLayout);
+    } catch (const std::exception& e) {
+        cerr << e.what() << " keeping the previous shaders\n";
+        for (replaced& r : stale) {
+            *r.slot = std::move(r.old);
+        }
+        shaders.rollback(); // so later rebuilds (resizes, variant switches) don't pick up the broken modules
+        return;
+    }
+    shaders.commit();
+    for (replaced& r : stale) {
+        retire(std::move(r.old));
+    }
+    rerecordRenderCmdBuffers();
+
+    using ms = std::chrono::duration<double, std::milli>;
+    cout << "reloaded " << stale.size() << (stale.size() == 1 ? " pipeline" : " pipelines") << ", shaders "
+        << ms(compiled - start).count() << " ms, pipelines " << ms(clock::now() - compiled).count() << " ms\n";
 }
 
 void appvk::printShaderStats() {
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "mapped_file.hpp"
+#include "shader_registry.hpp"
+#include "shader_compiler.hpp"
+
+#ifdef RUNTIME_SHADERS
+#include <shaderc/shaderc.hpp>
+
+namespace {
+    // bump when the compile options below change, so old cache entries aren't used
+    constexpr std::string_view optionsTag = "vulkan1.2 performance v2";
+
+    // resolves #include like glslangValidator -I does: next to the including file first, then the include directory
+    class includer : public shaderc::CompileOptions::IncluderInterface {
+    public:
+        explicit includer(std::string dir) : dir(std::move(dir)) {}
+
+        shaderc_include_result* GetInclude(const char* requested, shaderc_include_type type, const char* requesting, size_t) override {
+            auto* f = new included;
+            std::vector<std::filesystem::path> candidates;
+            if (type == shaderc_include_type_relative) {
+                candidates.push_back(std::filesystem::path(requesting).parent_path() / requested);
+            }
+            candidates.push_back(std::filesystem::path(dir) / requested);
+
+            for (const auto& c : candidates) {
+                std::ifstream in(c, std::ios::binary);
+                if (in) {
+                    f->name = c.string();
+                    f->content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                    break;
+                }
+            }
+            if (f->name.empty()) {
+                f->content = "cannot find " + std::string(requested); // an empty name tells shaderc the content is an error
+            }
+
+            f->result = { f->name.data(), f->name.size(), f->content.data(), f->content.size(), f };
+            return &f->result;
+        }
+
+        void ReleaseInclude(shaderc_include_result* r) override {
+            delete static_cast<included*>(r->user_data);
+        }
+
+    private:
+        struct included {
+            std::string name;
+            std::string content;
+            shaderc_include_result result;
+        };
+        std::string dir;
+    };
+}
+#endif
+
+glsl::compiler::compiler(std::string cacheDir, std::string includeDir) : cacheDir(std::move(cacheDir)), includeDir(std::move(includeDir)) {
+#ifdef RUNTIME_SHADERS
+    impl = new shaderc::Compiler();
+#endif
+}
+
+glsl::compiler::~compiler() {
+#ifdef RUNTIME_SHADERS
+    delete static_cast<shaderc::Compiler*>(impl);
+#endif
+}
+
+glsl::compiler::result glsl::compiler::compile(const std::string& path, const std::vector<std::string>& defines) {
+#ifndef RUNTIME_SHADERS
+    (void)defines;
+    throw std::runtime_error("cannot compile " + path + ", runtime shader compilation isn't built in!");
+#else
+    io::mappedFile source(path);
+
+    const std::string ext = std::filesystem::path(path).extension().string();
+    shaderc_shader_kind kind;
+    if (ext == ".vert") {
+        kind = shaderc_vertex_shader;
+    } else if (ext == ".frag") {
+        kind = shaderc_fragment_shader;
+    } else if (ext == ".comp") {
+        kind = shaderc_compute_shader;
+    } else {
+        throw std::runtime_error("unknown shader stage for " + path + "!");
+    }
+
+    shaderc::CompileOptions options;
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+    options.SetIncluder(std::make_unique<includer>(includeDir));
+    for (const std::string& d : defines) {
+        options.AddMacroDefinition(d);
+    }
+
+    // the key covers everything that changes the output. preprocessing pulls in the includes and is cheap next to
+    // compiling, so a cached shader still starts up fast.
+    auto& c = *static_cast<shaderc::Compiler*>(impl);
+    shaderc::PreprocessedSourceCompilationResult pre = c.PreprocessGlsl(reinterpret_cast<const char*>(source.data()), source.size(), kind, path.c_str(), options);
+    if (pre.GetCompilationStatus() != shaderc_compilation_status_success) {
+        throw std::runtime_error(pre.GetErrorMessage());
+    }
+    std::string keyed(pre.cbegin(), pre.cend());
+    keyed += ext;
+    keyed += optionsTag;
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << vkr::shaderRegistry::hash(keyed.data(), keyed.size()) << ".spv";
+    const std::string cachePath = cacheDir + "/" + name.str();
+
+    result r;
+
+    io::mappedFile cachedSpv;
+    if (cachedSpv.open(cachePath) && cachedSpv.size() % 4 == 0 && cachedSpv.size() > 0) {
+        r.spv.resize(cachedSpv.size() / 4);
+        std::copy(cachedSpv.begin(), cachedSpv.end(), reinterpret_cast<uint8_t*>(r.spv.data()));
+        r.cached = true;
+        return r;
+    }
+
+    shaderc::SpvCompilationResult out = c.CompileGlslToSpv(reinterpret_cast<const char*>(source.data()), source.size(), kind, path.c_str(), options);
+    if (out.GetCompilationStatus() != shaderc_compilation_status_success) {
+        throw std::runtime_error(out.GetErrorMessage());
+    }
+    r.spv.assign(out.cbegin(), out.cend());
+
+    // write to a temporary name and rename, so a crash never leaves a truncated entry behind
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    const std::string tmp = cachePath + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(r.spv.data()), r.spv.size() * sizeof(uint32_t));
+    }
+    std::filesystem::rename(tmp, cachePath, ec); // the cache is only an optimization, failing to write it is fine
+
+    return r;
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// glsl to spir-v compilation at runtime through shaderc, only compiled in with "make live" (-DRUNTIME_SHADERS).
+// every other build uses the .spv files shader/makefile produces.
+namespace glsl {
+    class compiler {
+    public:
+#ifdef RUNTIME_SHADERS
+        constexpr static bool available = true;
+#else
+        constexpr static bool available = false;
+#endif
+
+        struct result {
+            std::vector<uint32_t> spv;
+            bool cached = false; // came from the on-disk cache, the source is unchanged since it was last compiled
+        };
+
+        // compiled spir-v is cached in cacheDir, keyed by a hash of the preprocessed source (so edited includes count)
+        // and the compile options. #include "x" looks next to the including file, then in includeDir.
+        explicit compiler(std::string cacheDir = ".spv/cache", std::string includeDir = "shader/include");
+        ~compiler();
+
+        compiler(const compiler&) = delete;
+        compiler& operator=(const compiler&) = delete;
+
+        // the stage comes from the extension (.vert, .frag, .comp). throws with the compiler's messages on errors.
+        // defines are macro names, as if passed with -D.
+        result compile(const std::string& path, const std::vector<std::string>& defines = {});
+
+    private:
+        std::string cacheDir;
+        std::string includeDir;
+        void* impl = nullptr; // shaderc compiler, kept out of this header
+    };
+}
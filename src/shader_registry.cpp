@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "shader_registry.hpp"
+
+namespace {
+    constexpr uint32_t spirvMagic = 0x07230203;
+    constexpr size_t spirvHeaderWords = 5; // magic, version, generator, bound, schema
+}
+
+void vkr::shaderRegistry::destroy() {
+    names.clear();
+    previous.clear();
+    modules.clear();
+}
+
+VkShaderModule vkr::shaderRegistry::find(std::string_view name) const {
+    auto n = names.find(std::string(name));
+    if (n == names.end()) {
+        return VK_NULL_HANDLE;
+    }
+    return modules.at(n->second);
+}
+
+VkShaderModule vkr::shaderRegistry::add(std::string_view name, const void* code, size_t size) {
+    uint32_t magic = 0;
+    if (size >= sizeof(magic)) {
+        memcpy(&magic, code, sizeof(magic));
+    }
+    if (size % 4 != 0 || size < spirvHeaderWords * 4 || magic != spirvMagic) {
+        throw std::runtime_error("invalid spir-v in " + std::string(name) + "!");
+    }
+
+    const uint64_t h = hash(code, size);
+
+    // create the module before touching the names, so a failure leaves the registry as it was
+    auto m = modules.find(h);
+    if (m == modules.end()) {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = size;
+        createInfo.pCode = static_cast<const uint32_t*>(code);
+
+        VkShaderModule mod;
+        if (vkCreateShaderModule(dev, &createInfo, nullptr, &mod) != VK_SUCCESS) {
+            throw std::runtime_error("cannot create shader module!");
+        }
+        m = modules.emplace(h, shaderModule(dev, mod)).first;
+    }
+    const VkShaderModule mod = m->second;
+
+    auto [n, added] = names.try_emplace(std::string(name), h);
+    if (!added && n->second != h) {
+        // new contents under an old name (a reload). pipelines don't need their modules once they are created,
+        // so the old one can go as soon as no other name uses it.
+        const uint64_t old = std::exchange(n->second, h);
+        if (replacing) {
+            previous.try_emplace(n->first, old); // kept until commit() or rollback()
+        } else if (std::none_of(names.begin(), names.end(), [old](const auto& o) { return o.second == old; })) {
+            modules.erase(old);
+        }
+    }
+    return mod;
+}
+
+void vkr::shaderRegistry::beginReplace() {
+    replacing = true;
+}
+
+void vkr::shaderRegistry::commit() {
+    replacing = false;
+    previous.clear();
+    dropUnused();
+}
+
+void vkr::shaderRegistry::rollback() {
+    replacing = false;
+    for (const auto& [name, h] : previous) {
+        names[name] = h;
+    }
+    previous.clear();
+    dropUnused();
+}
+
+void vkr::shaderRegistry::rollback(std::string_view name) {
+    auto p = previous.find(std::string(name));
+    if (p != previous.end()) {
+        names[p->first] = p->second;
+        previous.erase(p); // the new module goes with the next commit() or rollback()
+    }
+}
+
+void vkr::shaderRegistry::dropUnused() {
+    for (auto m = modules.begin(); m != modules.end();) {
+        const uint64_t h = m->first;
+        if (std::none_of(names.begin(), names.end(), [h](const auto& n) { return n.second == h; })) {
+            m = modules.erase(m);
+        } else {
+            ++m;
+        }
+    }
+}
+
+uint64_t vkr::shaderRegistry::hash(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "deferred.hpp"
+
+namespace vkr {
+    // owns every shader module the app creates. each spir-v blob is validated and turned into a module once,
+    // and the module stays alive for pipeline rebuilds (resizes, variants) instead of being recreated from disk.
+    // modules are keyed by a hash of their contents, so identical blobs under different names share one.
+    // only the rendering thread creates pipelines, so this isn't thread safe.
+    class shaderRegistry {
+    public:
+        void init(VkDevice dev) { this->dev = dev; }
+        void destroy(); // before the device goes away
+
+        // the module previously added under name, or VK_NULL_HANDLE
+        VkShaderModule find(std::string_view name) const;
+
+        // throws if the blob isn't spir-v. returns the existing module if the same contents were added before.
+        // adding different contents under a name that is already taken replaces what find() returns for it.
+        VkShaderModule add(std::string_view name, const void* code, size_t size);
+
+        // a reload replaces modules by name. between beginReplace() and commit() or rollback() the modules it
+        // replaced stay alive, so a pipeline rebuild that fails can go back to them.
+        void beginReplace();
+        void commit(); // destroys the replaced modules nothing uses anymore
+        void rollback(); // every name replaced since beginReplace() gets its previous module back
+        void rollback(std::string_view name); // just the one
+
+        size_t size() const { return modules.size(); }
+
+        static uint64_t hash(const void* data, size_t size); // 64 bit FNV-1a
+
+    private:
+        VkDevice dev = VK_NULL_HANDLE;
+        std::unordered_map<uint64_t, shaderModule> modules; // by content hash
+        std::unordered_map<std::string, uint64_t> names; // name to content hash
+        bool replacing = false;
+        std::unordered_map<std::string, uint64_t> previous; // name to content hash before beginReplace()
+
+        void dropUnused();
+    };
+}
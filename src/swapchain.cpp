@@ -44,13 +44,24 @@ VkSurfaceFormatKHR appvk::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFor
 }
 
 VkPresentModeKHR appvk::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& modeList) {
+    VkPresentModeKHR wanted;
+    switch (settings.presentMode) {
+        case options::present::immediate: wanted = VK_PRESENT_MODE_IMMEDIATE_KHR; break; // tears, but never waits for vblank
+        case options::present::mailbox: wanted = VK_PRESENT_MODE_MAILBOX_KHR; break; // triple buffer
+        case options::present::fifoRelaxed: wanted = VK_PRESENT_MODE_FIFO_RELAXED_KHR; break; // tears only when a frame is late
+        default: wanted = VK_PRESENT_MODE_FIFO_KHR; break;
+    }
+
     for (const auto& mode : modeList) {
-        if (mode == VK_PRESENT_MODE_MAILBOX_KHR) { // triple buffer if possible
+        if (mode == wanted) {
+            presentMode = mode;
             return mode;
         }
     }
 
-    return VK_PRESENT_MODE_FIFO_KHR;
+    cout << "present mode " << options::presentName(settings.presentMode) << " not supported, using fifo\n";
+    presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    return VK_PRESENT_MODE_FIFO_KHR; // always supported
 }
 
 VkExtent2D appvk::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& cap) {
@@ -60,10 +71,9 @@ VkExtent2D appvk::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& cap) {
         VkExtent2D newV;
         // clamp width and height to [min, max] extent height
         
-        glfwGetFramebufferSize(w, (int*)&screenWidth, (int*)&screenHeight);
-        
-        newV.width = std::max(cap.minImageExtent.width, std::min(cap.maxImageExtent.width, static_cast<uint32_t>(screenWidth)));
-        newV.height = std::max(cap.minImageExtent.height, std::min(cap.minImageExtent.height, static_cast<uint32_t>(screenHeight)));
+        // the renderer might not be on the main thread, so use the size from the last input sample instead of asking glfw
+        newV.width = std::max(cap.minImageExtent.width, std::min(cap.maxImageExtent.width, static_cast<uint32_t>(fbWidth)));
+        newV.height = std::max(cap.minImageExtent.height, std::min(cap.maxImageExtent.height, static_cast<uint32_t>(fbHeight)));
         return newV;
     }
 }
@@ -121,22 +131,26 @@ void appvk::cleanupSwapChain() {
     for (unsigned int i = 0; i < framesInFlight; i++){
         vkDestroySemaphore(dev, imageAvailSems[i], nullptr);
         vkDestroySemaphore(dev, renderDoneSems[i], nullptr);
-        vkDestroyFence(dev, inFlightFences[i], nullptr);
     }
+    vkDestroySemaphore(dev, frameTimeline, nullptr);
+
+    gpuTimes.destroy();
 
     vkFreeCommandBuffers(dev, cp, commandBuffers.size(), commandBuffers.data());
 
     vkDestroyImageView(dev, depthView, nullptr);
-    vkFreeMemory(dev, depthMemory, nullptr);
+    freeMemory(depthMemory);
     vkDestroyImage(dev, depthImage, nullptr);
 
     vkDestroyImageView(dev, msImageView, nullptr);
-    vkFreeMemory(dev, msMemory, nullptr);
+    freeMemory(msMemory);
     vkDestroyImage(dev, msImage, nullptr);
 
     for (size_t i = 0; i < swapImages.size(); i++) {
-        vkFreeMemory(dev, mvpMemories[i], nullptr);
+        freeMemory(mvpMemories[i]);
         vkDestroyBuffer(dev, mvpBuffers[i], nullptr);
+        freeMemory(trampleMems[i]);
+        vkDestroyBuffer(dev, trampleBufs[i], nullptr);
     }
 
     vkDestroyDescriptorPool(dev, dPool, nullptr);
@@ -146,11 +160,14 @@ void appvk::cleanupSwapChain() {
         vkDestroyFramebuffer(dev, framebuffer, nullptr);
     }
 
-    vkDestroyPipeline(dev, skyPipe, nullptr);
-    vkDestroyPipeline(dev, terrainPipe, nullptr);
-    vkDestroyPipeline(dev, grassPipe, nullptr);
-    vkDestroyPipelineLayout(dev, terrainPipeLayout, nullptr);
-    vkDestroyPipelineLayout(dev, skyPipeLayout, nullptr);
+    skyPipe.reset();
+    shadedVariants.clear();
+    terrainPipe = VK_NULL_HANDLE;
+    grassPipe = VK_NULL_HANDLE;
+    impostorPipe = VK_NULL_HANDLE;
+    terrainPipeLayout.reset();
+    grassPipeLayout.reset();
+    skyPipeLayout.reset();
     vkDestroyRenderPass(dev, renderPass, nullptr);
     
     for (const auto& view : swapImageViews) {
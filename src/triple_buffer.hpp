@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace spsc {
+    // hands the latest value from one producer thread to one consumer thread without locks.
+    // the producer always has a slot to write into and the consumer always has a complete value to read,
+    // the two just swap slots through the middle one. values the consumer never picked up are dropped.
+    template <typename T>
+    class tripleBuffer {
+    public:
+        // producer side
+        void publish(const T& v) {
+            slots[back] = v;
+            back = middle.exchange(back | fresh, std::memory_order_acq_rel) & index;
+        }
+
+        // consumer side, returns false (and leaves out alone) if nothing was published since the last call
+        bool consume(T& out) {
+            if (!(middle.load(std::memory_order_relaxed) & fresh)) {
+                return false;
+            }
+            front = middle.exchange(front, std::memory_order_acq_rel) & index;
+            out = slots[front];
+            return true;
+        }
+
+    private:
+        constexpr static uint8_t index = 0x3;
+        constexpr static uint8_t fresh = 0x4; // set on the middle slot when the producer put it there
+
+        T slots[3]{};
+        uint8_t back = 0; // only touched by the producer
+        uint8_t front = 1; // only touched by the consumer
+        std::atomic<uint8_t> middle{2};
+    };
+}
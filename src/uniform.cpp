@@ -7,8 +7,18 @@ void appvk::createUniformBuffers() {
     for (size_t i = 0; i < swapImages.size(); i++) {
         createBuffer(sizeof(mvp), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        mvpBuffers[i], mvpMemories[i]);
+        mem::uniform, mvpBuffers[i], mvpMemories[i]);
     } 
+
+    // written by the CPU every frame too, see updateTrample()
+    trampleBufs.resize(swapImages.size());
+    trampleMems.resize(swapImages.size());
+
+    for (size_t i = 0; i < swapImages.size(); i++) {
+        createBuffer(sizeof(trampleFrame), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        mem::uniform, trampleBufs[i], trampleMems[i]);
+    }
 }
 
 void appvk::createDescriptorSetLayouts() {
@@ -34,6 +44,67 @@ void appvk::createDescriptorSetLayouts() {
         throw std::runtime_error("cannot create descriptor set!");
     }
 
+    // grass gets the terrain heightmap on top, field grass places its blades with it, then the wind and trample fields
+    // and the impostor atlas, color and normal
+    VkDescriptorSetLayoutBinding grassBindings[7] = { bindings[0], bindings[1] };
+
+    grassBindings[2].binding = 2;
+    grassBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    grassBindings[2].descriptorCount = 1;
+    grassBindings[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    grassBindings[3] = grassBindings[2];
+    grassBindings[3].binding = 3;
+
+    grassBindings[4] = grassBindings[2];
+    grassBindings[4].binding = 4;
+
+    grassBindings[5] = bindings[1];
+    grassBindings[5].binding = 5;
+
+    grassBindings[6] = bindings[1];
+    grassBindings[6].binding = 6;
+
+    VkDescriptorSetLayoutCreateInfo grassCreateInfo = createInfo;
+    grassCreateInfo.bindingCount = 7;
+    grassCreateInfo.pBindings = grassBindings;
+
+    if (vkCreateDescriptorSetLayout(dev, &grassCreateInfo, nullptr, &grassSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create grass descriptor set!");
+    }
+
+    // wind.comp reads the time from the uniform buffer and writes the field
+    VkDescriptorSetLayoutBinding windBindings[2] = {};
+
+    windBindings[0].binding = 0;
+    windBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    windBindings[0].descriptorCount = 1;
+    windBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    windBindings[1].binding = 1;
+    windBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    windBindings[1].descriptorCount = 1;
+    windBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo windCreateInfo = createInfo;
+    windCreateInfo.bindingCount = 2;
+    windCreateInfo.pBindings = windBindings;
+
+    if (vkCreateDescriptorSetLayout(dev, &windCreateInfo, nullptr, &windSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create wind descriptor set!");
+    }
+
+    // both trample passes read the frame's contacts and tiles and update the field
+    VkDescriptorSetLayoutBinding trampleBindings[2] = { windBindings[0], windBindings[1] };
+    trampleBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    VkDescriptorSetLayoutCreateInfo trampleCreateInfo = windCreateInfo;
+    trampleCreateInfo.pBindings = trampleBindings;
+
+    if (vkCreateDescriptorSetLayout(dev, &trampleCreateInfo, nullptr, &trampleSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("cannot create trample descriptor set!");
+    }
+
     VkDescriptorSetLayoutBinding bindings2[2] = {};
 
     bindings2[0].binding = 0;
@@ -57,18 +128,27 @@ void appvk::createDescriptorSetLayouts() {
 }
 
 void appvk::createDescriptorPools() {
-    size_t numPools = 2;
+    size_t numPools = 4;
     VkDescriptorPoolSize poolSizes[numPools];
 
+    // dPool holds the terrain, grass, wind and trample sets: a uniform buffer each but the trample set, the textures
+    // (terrain, grass, heightmap, wind and trample fields, both impostor atlas images), both fields again as storage
+    // images and the trample buffer
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = swapImages.size();
+    poolSizes[0].descriptorCount = swapImages.size() * 3;
 
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = swapImages.size();
+    poolSizes[1].descriptorCount = swapImages.size() * 7;
+
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[2].descriptorCount = swapImages.size() * 2;
+
+    poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[3].descriptorCount = swapImages.size();
 
     VkDescriptorPoolCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    createInfo.maxSets = swapImages.size() * numPools;
+    createInfo.maxSets = swapImages.size() * 4;
     createInfo.poolSizeCount = numPools;
     createInfo.pPoolSizes = poolSizes;
 
@@ -116,7 +196,7 @@ void appvk::allocDescriptorSetUniform(std::vector<VkDescriptorSet>& dSet) {
     }
 }
 
-void appvk::allocDescriptorSetTexture(std::vector<VkDescriptorSet>& dSet, VkSampler samp, VkImageView view) {
+void appvk::allocDescriptorSetTexture(std::vector<VkDescriptorSet>& dSet, VkSampler samp, VkImageView view, uint32_t binding) {
     for (size_t i = 0; i < swapImages.size(); i++) {
         VkDescriptorImageInfo imageInfo{};
         imageInfo.sampler = samp;
@@ -126,7 +206,7 @@ void appvk::allocDescriptorSetTexture(std::vector<VkDescriptorSet>& dSet, VkSamp
         VkWriteDescriptorSet set{};
         set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         set.dstSet = dSet[i];
-        set.dstBinding = 1;
+        set.dstBinding = binding;
         set.dstArrayElement = 0;
         set.descriptorCount = 1;
         set.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -134,4 +214,72 @@ void appvk::allocDescriptorSetTexture(std::vector<VkDescriptorSet>& dSet, VkSamp
 
         vkUpdateDescriptorSets(dev, 1, &set, 0, nullptr);
     }
-}
\ No newline at end of file
+}
+
+// the field stays in the general layout, wind.comp writes it and the grass vertex shaders sample it
+void appvk::allocDescriptorSetWind() {
+    for (size_t i = 0; i < swapImages.size(); i++) {
+        VkDescriptorImageInfo storageInfo{};
+        storageInfo.imageView = windView;
+        storageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo sampledInfo = storageInfo;
+        sampledInfo.sampler = windSamp;
+
+        VkWriteDescriptorSet sets[2] = {};
+        sets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        sets[0].dstSet = windSet[i];
+        sets[0].dstBinding = 1;
+        sets[0].dstArrayElement = 0;
+        sets[0].descriptorCount = 1;
+        sets[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        sets[0].pImageInfo = &storageInfo;
+
+        sets[1] = sets[0];
+        sets[1].dstSet = grassSet[i];
+        sets[1].dstBinding = 3;
+        sets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        sets[1].pImageInfo = &sampledInfo;
+
+        vkUpdateDescriptorSets(dev, 2, sets, 0, nullptr);
+    }
+}
+
+void appvk::allocDescriptorSetTrample() {
+    for (size_t i = 0; i < swapImages.size(); i++) {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = trampleBufs[i];
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(trampleFrame);
+
+        VkDescriptorImageInfo storageInfo{};
+        storageInfo.imageView = trampleView;
+        storageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo sampledInfo = storageInfo;
+        sampledInfo.sampler = trampleSamp;
+
+        VkWriteDescriptorSet sets[3] = {};
+        sets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        sets[0].dstSet = trampleSet[i];
+        sets[0].dstBinding = 0;
+        sets[0].dstArrayElement = 0;
+        sets[0].descriptorCount = 1;
+        sets[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        sets[0].pBufferInfo = &bufferInfo;
+
+        sets[1] = sets[0];
+        sets[1].dstBinding = 1;
+        sets[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        sets[1].pBufferInfo = nullptr;
+        sets[1].pImageInfo = &storageInfo;
+
+        sets[2] = sets[1];
+        sets[2].dstSet = grassSet[i];
+        sets[2].dstBinding = 4;
+        sets[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        sets[2].pImageInfo = &sampledInfo;
+
+        vkUpdateDescriptorSets(dev, 3, sets, 0, nullptr);
+    }
+}
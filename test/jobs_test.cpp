@@ -0,0 +1,155 @@
+// unit tests for the job pool, run with `make test`.
+// every check is an assert, so a failure aborts with the file and line.
+
+#undef NDEBUG
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "jobs.hpp"
+
+namespace {
+    // a job only starts once everything it depends on has finished, including across a chain
+    void dependencyOrder() {
+        jobs::pool p(4);
+        std::mutex m;
+        std::vector<int> order;
+        auto record = [&](int i) {
+            std::lock_guard<std::mutex> lock(m);
+            order.push_back(i);
+        };
+
+        jobs::handle a = p.submit([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            record(0);
+        });
+        jobs::handle b = p.submit([&] { record(1); }, {a});
+        jobs::handle c = p.submit([&] { record(2); }, {a});
+        jobs::handle d = p.submit([&] { record(3); }, {b, c});
+        p.wait(d);
+
+        assert(order.size() == 4);
+        assert(order.front() == 0);
+        assert(order.back() == 3);
+        assert(a->done() && b->done() && c->done());
+
+        // depending on something already finished, or on nothing at all, runs right away
+        bool ran = false;
+        p.wait(p.submit([&] { ran = true; }, {a, jobs::handle()}));
+        assert(ran);
+    }
+
+    // errors come out of wait, dependents still run, and the vector wait finishes everything first
+    void exceptions() {
+        jobs::pool p(2);
+
+        jobs::handle bad = p.submit([] { throw std::runtime_error("bad job"); });
+        bool dependentRan = false;
+        jobs::handle after = p.submit([&] { dependentRan = true; }, {bad});
+
+        bool caught = false;
+        try {
+            p.wait(bad);
+        } catch (const std::runtime_error& e) {
+            caught = std::string(e.what()) == "bad job";
+        }
+        assert(caught);
+        p.wait(after);
+        assert(dependentRan);
+
+        bool slowDone = false;
+        std::vector<jobs::handle> hs;
+        hs.push_back(p.submit([] { throw std::runtime_error("first"); }));
+        hs.push_back(p.submit([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            slowDone = true;
+        }));
+        caught = false;
+        try {
+            p.wait(hs);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+        assert(slowDone);
+    }
+
+    // a job waiting on jobs it submitted helps run them, so even a single worker can't deadlock
+    void waitInsideJob() {
+        jobs::pool p(1);
+        int sum = 0;
+        jobs::handle outer = p.submit([&] {
+            std::vector<jobs::handle> inner;
+            std::vector<int> parts(8, 0);
+            for (int i = 0; i < 8; i++) {
+                inner.push_back(p.submit([&parts, i] { parts[i] = i + 1; }));
+            }
+            p.wait(inner);
+            for (int v : parts) {
+                sum += v;
+            }
+        });
+        p.wait(outer);
+        assert(sum == 36);
+
+        // parallelFor from inside a job as well
+        std::vector<int> squares(64, 0);
+        p.wait(p.submit([&] { p.parallelFor(squares.size(), [&](size_t i) { squares[i] = int(i * i); }); }));
+        for (size_t i = 0; i < squares.size(); i++) {
+            assert(squares[i] == int(i * i));
+        }
+    }
+
+    // work pushed onto one worker's queue gets taken by the others
+    void stealing() {
+        jobs::pool p(4);
+        std::mutex m;
+        std::set<std::thread::id> threads;
+        std::thread::id spawner;
+
+        p.wait(p.submit([&] {
+            spawner = std::this_thread::get_id();
+            std::vector<jobs::handle> children;
+            for (int i = 0; i < 64; i++) {
+                // all of these land on the spawning worker's own deque
+                children.push_back(p.submit([&] {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    std::lock_guard<std::mutex> lock(m);
+                    threads.insert(std::this_thread::get_id());
+                }));
+            }
+            p.wait(children);
+        }));
+
+        threads.erase(spawner);
+        assert(!threads.empty());
+    }
+
+    // destroying the pool still runs whatever was queued
+    void drainOnDestroy() {
+        std::atomic<int> count{0};
+        {
+            jobs::pool p(2);
+            for (int i = 0; i < 100; i++) {
+                p.submit([&] { count++; });
+            }
+        }
+        assert(count == 100);
+    }
+}
+
+int main() {
+    dependencyOrder();
+    exceptions();
+    waitInsideJob();
+    stealing();
+    drainOnDestroy();
+    printf("jobs: all tests passed\n");
+    return 0;
+}